@@ -54,6 +54,12 @@ end)
 osc_mono['/left'] = tjost.plugin({name='osc_out', port='osc.left'})
 osc_mono['/right'] = tjost.plugin({name='osc_out', port='osc.right'})
 
+-- same split without entering Lua for matching paths, '/left/...' is routed like '/left'
+osc_split = tjost.plugin({name='osc_in', port='osc.split'})
+tjost.route(osc_split, osc_mono, function(time, path, fmt, ...)
+	osc_out(time, path, fmt, ...)
+end)
+
 midi_out = {
 	base = tjost.plugin({name='midi_out', port='base'}),
 	lead = tjost.plugin({name='midi_out', port='lead'})
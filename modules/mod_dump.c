@@ -25,7 +25,6 @@ typedef struct _Data Data;
 
 struct _Data {
 	Tjost_Pipe pipe;
-	osc_data_t buffer [TJOST_BUF_SIZE];
 	int verbose;
 };
 
@@ -204,14 +203,6 @@ _serialize_packet(jack_nframes_t time, osc_data_t *buffer, size_t size, int verb
 	}
 }
 
-static osc_data_t *
-_alloc(Tjost_Event *tev, void *arg)
-{
-	Data *dat = tev->module->dat;
-
-	return dat->buffer;
-}
-
 static int
 _sched(Tjost_Event *tev, osc_data_t *buf, void *arg)
 {
@@ -231,36 +222,20 @@ process_out(jack_nframes_t nframes, void *arg)
 
 	jack_nframes_t last = jack_last_frame_time(host->client);
 
-	unsigned int count = eina_inlist_count(module->queue);
+	unsigned int count = tjost_module_queue_count(module);
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last;
-		}
-
-		//tev->time -= last; // time relative to current period
-		if(tjost_pipe_produce(&dat->pipe, module, tev->time, tev->size, tev->buf))
+		//time -= last; // time relative to current period
+		if(tjost_pipe_produce(&dat->pipe, module, time, tev->size, tev->buf))
 			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_produce error");
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
 	}
 
 	if(count > 0)
-	{
-		if(tjost_pipe_flush(&dat->pipe))
-			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_flush error");
-	}
+		tjost_pipe_flush(&dat->pipe, module);
 
 	return 0;
 }
@@ -279,9 +254,9 @@ add(Tjost_Module *module)
 	dat->verbose = luaL_optint(L, -1, 0) ? 1 : 0;
 	lua_pop(L, 1);
 
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
-	if(tjost_pipe_listen_start(&dat->pipe, loop, _alloc, _sched, NULL))
+	if(tjost_pipe_listen_start(&dat->pipe, loop, NULL, _sched, NULL))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not start listening in tjost pipe");
 
 	module->dat = dat;
@@ -296,6 +271,7 @@ del(Tjost_Module *module)
 	Data *dat = module->dat;
 
 	tjost_pipe_listen_stop(&dat->pipe);
+	tjost_pipe_consume(&dat->pipe, NULL, _sched, NULL); // dump what is left, wakeup may have been held back
 	tjost_pipe_deinit(&dat->pipe);
 
 	tjost_free(module->host, dat);
@@ -28,24 +28,12 @@ process_out(jack_nframes_t nframes, void *arg)
 	jack_nframes_t last = jack_last_frame_time(host->client);
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution in next periods
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last + nframes;
-		}
-
-		tjost_host_schedule(host, module, tev->time + nframes, tev->size, tev->buf); // schedule for next period
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
+		// late events have been moved to last by the drain and thus loop back one period later like any other
+		tjost_host_schedule(host, module, time + nframes, tev->size, tev->buf); // schedule for next period
 	}
 
 	return 0;
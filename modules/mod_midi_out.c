@@ -88,24 +88,11 @@ process_out(jack_nframes_t nframes, void *arg)
 	data.module = module;
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last;
-		}
-
-		osc_dispatch_method(tev->time - last, tev->buf, tev->size, methods, NULL, NULL, &data);
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
+		osc_dispatch_method(time - last, tev->buf, tev->size, methods, NULL, NULL, &data);
 	}
 
 	return 0;
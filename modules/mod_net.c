@@ -127,7 +127,11 @@ mod_net_send_cb(osc_stream_t *stream, size_t len, void *data)
 	Tjost_Module *module = data;
 	Mod_Net *net = module->dat;
 
-	jack_ringbuffer_read_advance(net->rb_tx, len);
+	if(net->sending)
+	{
+		tjost_pipe_release(&net->pipe_tx, net->sending);
+		net->sending = NULL;
+	}
 	_next(module);
 }
 
@@ -135,102 +139,58 @@ static void
 _next(Tjost_Module *module)
 {
 	Mod_Net *net = module->dat;
+	Tjost_Pipe_Record *rec;
 
-	Tjost_Event tev;
-	if(jack_ringbuffer_read_space(net->rb_tx) >= sizeof(Tjost_Event))
-	{
-		jack_ringbuffer_peek(net->rb_tx, (char *)&tev, sizeof(Tjost_Event));
-		if(jack_ringbuffer_read_space(net->rb_tx) >= sizeof(Tjost_Event) + tev.size)
-		{
-			jack_ringbuffer_read_advance(net->rb_tx, sizeof(Tjost_Event));
+	if(net->sending) // wait for send_cb
+		return;
 
-			jack_time_t usecs = jack_frames_to_time(module->host->client, tev.time) - net->sync_jack;
+	// skip invalid records until one is sent or the pipe is empty
+	while((rec = tjost_pipe_peek(&net->pipe_tx)))
+	{
+		jack_time_t usecs = jack_frames_to_time(module->host->client, rec->time) - net->sync_jack;
 
-			uint32_t size = tev.size;
-			uint32_t sec;
-			uint32_t frac;
-			if(net->delay_sec || net->delay_nsec)
-			{
-				sec = net->sync_osc.tv_sec + net->delay_sec;
-				uint64_t nsec = net->sync_osc.tv_nsec + usecs*1e3 + net->delay_nsec;
-				while(nsec > 1e9)
-				{
-					sec += 1;
-					nsec -= 1e9;
-				}
-				frac = nsec * NSEC_PER_NTP_SLICE;
-			}
-			else
+		uint32_t sec;
+		uint32_t frac;
+		if(net->delay_sec || net->delay_nsec)
+		{
+			sec = net->sync_osc.tv_sec + net->delay_sec;
+			uint64_t nsec = net->sync_osc.tv_nsec + usecs*1e3 + net->delay_nsec;
+			while(nsec > 1e9)
 			{
-				// immediate execution
-				sec = 0UL;
-				frac = 1UL;
+				sec += 1;
+				nsec -= 1e9;
 			}
-			sec = htobe32(sec);
-			frac = htobe32(frac);
-		
-			char ch;
-			jack_ringbuffer_peek(net->rb_tx, &ch, 1);
-			switch(ch)
+			frac = nsec * NSEC_PER_NTP_SLICE;
+		}
+		else
+		{
+			// immediate execution
+			sec = 0UL;
+			frac = 1UL;
+		}
+		sec = htobe32(sec);
+		frac = htobe32(frac);
+
+		switch(rec->buf[0])
+		{
+			case '#':
+				//FIXME rewrite bundle timestamp
+			case '/':
 			{
-				case '#':
-				{
-					uv_buf_t msg [2];
-					jack_ringbuffer_data_t vec [2];
-					jack_ringbuffer_get_read_vector(net->rb_tx, vec);
-
-					if(size <= vec[0].len)
-					{
-						//FIXME rewrite bundle timestamp
-						msg[0].base = vec[0].buf;
-						msg[0].len = size;
-					
-						msg[1].base = NULL;
-						msg[1].len = 0;
-					}
-					else // size > vec[0].len;
-					{
-						msg[0].base = vec[0].buf;
-						msg[0].len = vec[0].len;
-
-						msg[1].base = vec[1].buf;
-						msg[1].len = size - vec[0].len;
-					}
-
-					osc_stream_send2(&net->stream, msg, msg[1].len > 0 ? 2 : 1);
-
-					break;
-				}
-				case '/':
-				{
-					uv_buf_t msg [2];
-					jack_ringbuffer_data_t vec [2];
-					jack_ringbuffer_get_read_vector(net->rb_tx, vec);
-
-					if(size <= vec[0].len)
-					{
-						msg[0].base = vec[0].buf;
-						msg[0].len = size;
-				
-						msg[1].base = NULL;
-						msg[1].len = 0;
-					}
-					else // size > vec[0].len
-					{
-						msg[0].base = vec[0].buf;
-						msg[0].len = vec[0].len;
-						
-						msg[1].base = vec[1].buf;
-						msg[1].len = size - vec[0].len;
-					}
-
-					osc_stream_send2(&net->stream, msg, msg[1].len > 0 ? 2 : 1);
-
-					break;
-				}
-				default:
-					break; //TODO report error
+				// records are contiguous in the pipe, send in place
+				uv_buf_t msg = {
+					.base = (char *)rec->buf,
+					.len = rec->size
+				};
+
+				net->sending = rec;
+				osc_stream_send2(&net->stream, &msg, 1);
+
+				return;
 			}
+			default:
+				tjost_pipe_release(&net->pipe_tx, rec); //TODO report error
+				break;
 		}
 	}
 }
@@ -264,41 +224,19 @@ mod_net_process_out(Tjost_Module *module, jack_nframes_t nframes)
 
 	jack_nframes_t last = jack_last_frame_time(host->client);
 
-	unsigned int count = eina_inlist_count(module->queue);
+	unsigned int count = tjost_module_queue_count(module);
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last;
-		}
-
-		if(jack_ringbuffer_write_space(net->rb_tx) < sizeof(Tjost_Event) + tev->size)
-			tjost_host_message_push(host, MOD_NAME": %s", "ringbuffer overflow");
-		else
-		{
-			jack_ringbuffer_write(net->rb_tx, (const char *)tev, sizeof(Tjost_Event));
-			jack_ringbuffer_write(net->rb_tx, (const char *)tev->buf, tev->size);
-		}
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
+		if(tjost_pipe_produce(&net->pipe_tx, module, time, tev->size, tev->buf))
+			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_produce error");
 	}
 
 	if(count > 0)
-	{
-		int err;
-		if((err = uv_async_send(&net->asio)))
-			tjost_host_message_push(host, MOD_NAME": %s", uv_err_name(err));
-	}
+		tjost_pipe_flush(&net->pipe_tx, module);
 
 	return 0;
 }
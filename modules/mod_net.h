@@ -32,7 +32,8 @@ typedef struct _Mod_Net	Mod_Net;
 typedef enum _Unroll_Type {UNROLL_NONE, UNROLL_PARTIAL, UNROLL_FULL} Unroll_Type;
 
 struct _Mod_Net {
-	jack_ringbuffer_t *rb_tx;
+	Tjost_Pipe pipe_tx;
+	Tjost_Pipe_Record *sending; // in pipe_tx until sent
 	uv_async_t asio;
 	Tjost_Pipe pipe_rx;
 
@@ -124,9 +124,11 @@ add(Tjost_Module *module)
 	Data *dat = tjost_alloc(module->host, sizeof(Data));
 	memset(dat, 0, sizeof(Data));
 
-	if(!(dat->net.rb_tx = jack_ringbuffer_create(TJOST_RINGBUF_SIZE)))
-		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize ringbuffer");
-	if(tjost_pipe_init(&dat->net.pipe_rx))
+	if(tjost_pipe_init(&dat->net.pipe_tx, module))
+		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize pipe_tx");
+	if(dat->net.pipe_tx.policy == TJOST_PIPE_BLOCK) // producer is the real time thread
+		dat->net.pipe_tx.policy = TJOST_PIPE_DROP_NEWEST;
+	if(tjost_pipe_init(&dat->net.pipe_rx, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize pipe_rx");
 
 	int err;
@@ -139,6 +141,7 @@ add(Tjost_Module *module)
 	dat->net.asio.data = module;
 	if((err = uv_async_init(&dat->loop, &dat->net.asio, mod_net_asio)))
 		MOD_ADD_ERR(module->host, MOD_NAME, uv_err_name(err));
+	tjost_wakeup_init(&dat->net.pipe_tx.wake, &dat->net.asio, dat->net.pipe_tx.rb);
 
 	dat->net.sync.data = module;
 	if((err = uv_timer_init(&dat->loop, &dat->net.sync)))
@@ -192,12 +195,12 @@ del(Tjost_Module *module)
 	if((err = uv_timer_stop(&dat->net.sync)))
 		fprintf(stderr, MOD_NAME": %s\n", uv_err_name(err));
 	uv_close((uv_handle_t *)&dat->quit, NULL);
+	tjost_host_wakeup_cancel(&dat->net.pipe_tx.wake);
 	uv_close((uv_handle_t *)&dat->net.asio, NULL);
 
 	uv_loop_close(&dat->loop);
 
-	if(dat->net.rb_tx)
-		jack_ringbuffer_free(dat->net.rb_tx);
+	tjost_pipe_deinit(&dat->net.pipe_tx);
 	tjost_pipe_deinit(&dat->net.pipe_rx);
 
 	tjost_free(module->host, dat);
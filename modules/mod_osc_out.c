@@ -38,27 +38,14 @@ process_out(jack_nframes_t nframes, void *arg)
 	jack_osc_clear_buffer(port_buf);
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last;
-		}
-
 		if(jack_osc_max_event_size(port_buf) < tev->size)
 			tjost_host_message_push(host, MOD_NAME": %s", "buffer overflow");
 		else
-			jack_osc_event_write(port_buf, tev->time - last, tev->buf, tev->size);
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
+			jack_osc_event_write(port_buf, time - last, tev->buf, tev->size);
 	}
 
 	return 0;
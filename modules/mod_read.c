@@ -26,10 +26,10 @@ typedef struct _Data Data;
 struct _Data {
 	Tjost_Pipe pipe;
 	uv_async_t asio;
+	Tjost_Wakeup wake;
 
 	FILE *f;
 	jack_nframes_t offset;
-	osc_data_t buffer [TJOST_BUF_SIZE];
 };
 
 static osc_data_t *
@@ -61,9 +61,8 @@ process_in(jack_nframes_t nframes, void *arg)
 	if(tjost_pipe_consume(&dat->pipe, _alloc, _sched, NULL))
 		tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_consume error");
 
-	int err;
-	if((err = uv_async_send(&dat->asio)))
-		tjost_host_message_push(host, MOD_NAME": %s", uv_err_name(err));
+	// refill pipe
+	tjost_host_wakeup(host, &dat->wake, module);
 
 	return 0;
 }
@@ -76,25 +75,42 @@ _asio(uv_async_t *handle)
 	
 	while(!feof(dat->f) && (tjost_pipe_space(&dat->pipe) > TJOST_BUF_SIZE))
 	{
+		// reserve room for the largest record before consuming its header from the file
+		osc_data_t *buf = tjost_pipe_reserve(&dat->pipe, TJOST_BUF_SIZE);
+		if(!buf)
+			break; // retry on next wakeup
+
 		uint32_t ntime;
 		uint32_t nsize;
-		fread(&ntime, sizeof(uint32_t), 1, dat->f);
+		if( (fread(&ntime, sizeof(uint32_t), 1, dat->f) != 1)
+			|| (fread(&nsize, sizeof(uint32_t), 1, dat->f) != 1) )
+			break; // end of file
 		ntime = ntohl(ntime);
-		fread(&nsize, sizeof(uint32_t), 1, dat->f);
 		nsize = ntohl(nsize);
-		fread(dat->buffer, sizeof(osc_data_t), nsize, dat->f);
-		
-		Tjost_Event tev;
-		tev.time = ntime;
-		tev.size = nsize;
 
-		if(osc_check_message(dat->buffer, tev.size))
+		if(nsize > TJOST_BUF_SIZE)
 		{
-			if(tjost_pipe_produce(&dat->pipe, module, ntime, nsize, dat->buffer))
-				fprintf(stderr, MOD_NAME": tjost_pipe_produce error\n");
+			fprintf(stderr, MOD_NAME": rx OSC message too large\n");
+
+			// skip payload through the reserved slot, works for pipes, too
+			while(nsize > 0)
+			{
+				size_t n = nsize > TJOST_BUF_SIZE ? TJOST_BUF_SIZE : nsize;
+				if(fread(buf, sizeof(osc_data_t), n, dat->f) != n)
+					break;
+				nsize -= n;
+			}
+			continue;
 		}
-		else
+
+		// read directly into the pipe
+		if(fread(buf, sizeof(osc_data_t), nsize, dat->f) != nsize)
+			break; // truncated file
+
+		if(!osc_check_message(buf, nsize))
 			fprintf(stderr, MOD_NAME": rx OSC message invalid\n");
+		else if(tjost_pipe_commit(&dat->pipe, module, ntime, nsize))
+			fprintf(stderr, MOD_NAME": tjost_pipe_commit error\n");
 	}
 }
 
@@ -132,8 +148,9 @@ add(Tjost_Module *module)
 	int err;
 	if((err = uv_async_init(loop, &dat->asio, _asio)))
 		MOD_ADD_ERR(module->host, MOD_NAME, uv_err_name(err));
+	tjost_wakeup_init(&dat->wake, &dat->asio, NULL);
 
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
 
 	module->dat = dat;
@@ -148,6 +165,7 @@ del(Tjost_Module *module)
 	Data *dat = module->dat;
 	
 	tjost_pipe_deinit(&dat->pipe);
+	tjost_host_wakeup_cancel(&dat->wake);
 	uv_close((uv_handle_t *)&dat->asio, NULL);
 
 	if( dat->f && (dat->f != stdout) )
@@ -114,7 +114,7 @@ add(Tjost_Module *module)
 	if(rtmidic_in_callback_set(dat->dev, &dat->cb))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not set callback");
 
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
 	
 	module->dat = dat;
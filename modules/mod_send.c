@@ -280,7 +280,7 @@ add(Tjost_Module *module)
 	
 	uv_loop_t *loop = uv_default_loop();
 
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
 
 	dat->recv_client.data = module;
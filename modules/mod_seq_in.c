@@ -144,7 +144,7 @@ add(Tjost_Module *module)
 	if(snd_seq_poll_descriptors(dat->seq, &pfds, 1, events) != 1)
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not get poll descriptors");
 
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
 
 	uv_loop_t *loop = uv_default_loop();
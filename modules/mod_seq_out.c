@@ -30,7 +30,6 @@ struct _Data {
 	int queue;
 
 	Tjost_Pipe pipe;
-	osc_data_t buffer [TJOST_BUF_SIZE];
 };
 
 static int
@@ -85,15 +84,6 @@ static osc_method_t methods [] = {
 	{NULL, NULL, NULL}
 };
 
-static osc_data_t *
-_alloc(Tjost_Event *tev, void *arg)
-{
-	Tjost_Module *module = tev->module;
-	Data *dat = module->dat;
-
-	return dat->buffer;
-}
-
 static int
 _sched(Tjost_Event *tev, osc_data_t *buf, void *arg)
 {
@@ -113,36 +103,19 @@ process_out(jack_nframes_t nframes, void *arg)
 
 	jack_nframes_t last = jack_last_frame_time(host->client);
 
-	unsigned int count = eina_inlist_count(module->queue);
+	unsigned int count = tjost_module_queue_count(module);
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last;
-		}
-
-		tev->time -= last; // time relative to current period
-		if(tjost_pipe_produce(&dat->pipe, module, tev->time, tev->size, tev->buf))
+		if(tjost_pipe_produce(&dat->pipe, module, time - last, tev->size, tev->buf))
 			tjost_host_message_push(host, MOD_NAME": %s", "ringbuffer overflow");
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
 	}
 
 	if(count > 0)
-	{
-		if(tjost_pipe_flush(&dat->pipe))
-			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_flush error");
-	}
+		tjost_pipe_flush(&dat->pipe, module);
 
 	return 0;
 }
@@ -181,9 +154,9 @@ add(Tjost_Module *module)
 	
 	uv_loop_t *loop = uv_default_loop();
 
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
-	tjost_pipe_listen_start(&dat->pipe, loop, _alloc, _sched, NULL);
+	tjost_pipe_listen_start(&dat->pipe, loop, NULL, _sched, NULL);
 
 	module->dat = dat;
 	module->type = TJOST_MODULE_OUTPUT;
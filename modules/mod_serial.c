@@ -177,36 +177,20 @@ process_out(jack_nframes_t nframes, void *arg)
 
 	jack_nframes_t last = jack_last_frame_time(host->client);
 
-	unsigned int count = eina_inlist_count(module->queue);
+	unsigned int count = tjost_module_queue_count(module);
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last;
-		}
-
-		//tev->time -= last; // time relative to current period
-		if(tjost_pipe_produce(&dat->pipe_tx, module, tev->time, tev->size, tev->buf))
+		//time -= last; // time relative to current period
+		if(tjost_pipe_produce(&dat->pipe_tx, module, time, tev->size, tev->buf))
 			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_produce error");
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
 	}
 
 	if(count > 0)
-	{
-		if(tjost_pipe_flush(&dat->pipe_tx))
-			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_flush error");
-	}
+		tjost_pipe_flush(&dat->pipe_tx, module);
 
 	return 0;
 }
@@ -229,11 +213,11 @@ add(Tjost_Module *module)
 	
 	uv_loop_t *loop = uv_default_loop();
 
-	if(tjost_pipe_init(&dat->pipe_tx))
+	if(tjost_pipe_init(&dat->pipe_tx, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize pipe_tx");
 	if(tjost_pipe_listen_start(&dat->pipe_tx, loop, _tx_alloc, _tx_sched, NULL))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize pipe_tx");
-	if(tjost_pipe_init(&dat->pipe_rx))
+	if(tjost_pipe_init(&dat->pipe_rx, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize pipe_rx");
 
 	if(osc_stream_init(loop, &dat->stream, uri, _recv_cb, _send_cb, module))
@@ -90,7 +90,7 @@ add(Tjost_Module *module)
 	const int msec = luaL_optnumber(L, -1, 1.f) * 1000;
 	lua_pop(L, 1);
 	
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
 
 	uv_loop_t *loop = uv_default_loop();
@@ -28,18 +28,8 @@ struct _Data {
 
 	FILE *f;
 	jack_nframes_t offset;
-	osc_data_t buffer [TJOST_BUF_SIZE];
 };
 
-static osc_data_t *
-_alloc(Tjost_Event *tev, void *arg)
-{
-	Tjost_Module *module = tev->module;
-	Data *dat = module->dat;
-
-	return dat->buffer;
-}
-
 static int
 _sched(Tjost_Event *tev, osc_data_t *buf, void *arg)
 {
@@ -71,36 +61,19 @@ process_out(jack_nframes_t nframes, void *arg)
 	if(dat->offset == 0) //TODO add way to reset this
 		dat->offset = last;
 
-	unsigned int count = eina_inlist_count(module->queue);
+	unsigned int count = tjost_module_queue_count(module);
 
 	// handle events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
+	jack_nframes_t time;
+	while((tev = tjost_module_drain(module, last, nframes, &time)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
-			tev->time = last;
-		else if(tev->time < last)
-		{
-			tjost_host_message_push(host, MOD_NAME": %s %i", "late event", tev->time - last);
-			tev->time = last;
-		}
-
-		tev->time -= dat->offset; // relative time to first written event
-		if(tjost_pipe_produce(&dat->pipe, module, tev->time, tev->size, tev->buf))
+		if(tjost_pipe_produce(&dat->pipe, module, time - dat->offset, tev->size, tev->buf))
 			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_produce error");
-
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
 	}
 
 	if(count > 0)
-	{
-		tjost_pipe_flush(&dat->pipe);
-			tjost_host_message_push(host, MOD_NAME": %s", "tjost_pipe_flush error");
-	}
+		tjost_pipe_flush(&dat->pipe, module);
 
 	return 0;
 }
@@ -133,9 +106,9 @@ add(Tjost_Module *module)
 	fwrite(&nsrate, sizeof(uint32_t), 1, dat->f);
 	fflush(dat->f);
 
-	if(tjost_pipe_init(&dat->pipe))
+	if(tjost_pipe_init(&dat->pipe, module))
 		MOD_ADD_ERR(module->host, MOD_NAME, "could not initialize tjost pipe");
-	tjost_pipe_listen_start(&dat->pipe, loop, _alloc, _sched, NULL);
+	tjost_pipe_listen_start(&dat->pipe, loop, NULL, _sched, NULL);
 
 	module->dat = dat;
 	module->type = TJOST_MODULE_OUTPUT;
@@ -149,6 +122,7 @@ del(Tjost_Module *module)
 	Data *dat = module->dat;
 
 	tjost_pipe_listen_stop(&dat->pipe);
+	tjost_pipe_consume(&dat->pipe, NULL, _sched, NULL); // write out what is left, wakeup may have been held back
 	tjost_pipe_deinit(&dat->pipe);
 
 	if( dat->f && (dat->f != stdout) )
@@ -47,11 +47,11 @@ _quit(uv_async_t *handle)
 static void
 _msg(uv_async_t *handle)
 {
-	static char str [1024]; // TODO how big?
+	static char str [TJOST_LOG_LINE_SIZE];
 
 	Tjost_Host *host = handle->data;
 
-	while(tjost_host_message_pull(host, str))
+	while(tjost_host_message_pull(host, str, TJOST_LOG_LINE_SIZE))
 		fprintf(stderr, "MESSAGE: %s\n", str);
 }
 
@@ -73,250 +73,360 @@ _alloc(void *ud, void *ptr, size_t osize, size_t nsize)
 
 	if(nsize == 0) {
 		if(ptr)
-			tjost_free(host, ptr);
+			tjost_heap_free(host, TJOST_HEAP_LUA, ptr);
 		return NULL;
 	}
 	else {
 		if(ptr)
-			return tjost_realloc(host, nsize, ptr);
+			return tjost_heap_realloc(host, TJOST_HEAP_LUA, nsize, ptr);
 		else
-			return tjost_alloc(host, nsize);
+			return tjost_heap_alloc(host, TJOST_HEAP_LUA, nsize);
 	}
 }
 
+Tjost_Event *
+tjost_event_ref(Tjost_Event *tev)
+{
+	tev->ref++;
+
+	return tev;
+}
+
+void
+tjost_event_unref(Tjost_Host *host, Tjost_Event *tev)
+{
+	if(--tev->ref == 0)
+		tjost_event_free(host, tev);
+}
+
+// queued events are charged to the quota of their source module until popped or drained
 static int
-_tjost_schedule_sort(const void *dat1, const void *dat2)
+_tjost_quota_charge(Tjost_Host *host, Tjost_Module *module, size_t len)
 {
-	const Eina_Inlist *l1 = (const Eina_Inlist *)dat1;
-	const Eina_Inlist *l2 = (const Eina_Inlist *)dat2;
+	if(module == TJOST_MODULE_BROADCAST)
+		return 0;
 
-	Tjost_Event *ev1 = EINA_INLIST_CONTAINER_GET(l1, Tjost_Event);
-	Tjost_Event *ev2 = EINA_INLIST_CONTAINER_GET(l2, Tjost_Event);
+	Tjost_Quota *quota = &module->quota;
+	size_t size = sizeof(Tjost_Event) + len;
 
-	return ev1->time <= ev2->time ? -1 : 1;
+	if(quota->limit && (quota->used + size > quota->limit))
+	{
+		if(quota->policy == TJOST_QUOTA_DROP)
+		{
+			quota->dropped++;
+			tjost_host_message_push(host, "quota: dropped event of %i bytes", (int)len);
+			return -1;
+		}
+
+		quota->exceeded++;
+		tjost_host_message_push(host, "quota: exceeded by event of %i bytes", (int)len);
+	}
+
+	quota->used += size;
+	if(quota->used > quota->peak)
+		quota->peak = quota->used;
+
+	return 0;
+}
+
+void
+tjost_quota_release(Tjost_Module *module, size_t len)
+{
+	if(module != TJOST_MODULE_BROADCAST)
+		module->quota.used -= sizeof(Tjost_Event) + len;
 }
 
 void
 tjost_host_schedule(Tjost_Host *host, Tjost_Module *module, jack_nframes_t time, size_t len, void *buf)
 {
-	Tjost_Event *tev = tjost_alloc(host, sizeof(Tjost_Event) + len);
+	if(_tjost_quota_charge(host, module, len))
+		return;
+
+	Tjost_Event *tev = tjost_event_alloc(host, len);
 
+	if(!tev)
+	{
+		tjost_quota_release(module, len);
+		return;
+	}
+
+	tev->ref = 1;
 	tev->time = time;
 	tev->size = len;
 	tev->module = module; // source module
 	memcpy(tev->buf, buf, len);
 
-	host->queue = eina_inlist_sorted_insert(host->queue, EINA_INLIST_GET(tev), _tjost_schedule_sort);
+	tjost_queue_insert(&host->queue, tev);
 }
 
 osc_data_t *
 tjost_host_schedule_inline(Tjost_Host *host, Tjost_Module *module, jack_nframes_t time, size_t len)
 {
-	Tjost_Event *tev = tjost_alloc(host, sizeof(Tjost_Event) + len);
+	// callers write in place, hand out a scratch buffer for dropped events
+	if(_tjost_quota_charge(host, module, len))
+		return len <= TJOST_BUF_SIZE ? host->sink : NULL;
+
+	Tjost_Event *tev = tjost_event_alloc(host, len);
 
+	if(!tev)
+	{
+		tjost_quota_release(module, len);
+		return NULL;
+	}
+
+	tev->ref = 1;
 	tev->time = time;
 	tev->size = len;
 	tev->module = module; // source module
 
-	host->queue = eina_inlist_sorted_insert(host->queue, EINA_INLIST_GET(tev), _tjost_schedule_sort);
+	tjost_queue_insert(&host->queue, tev);
 	return tev->buf;
 }
 
 void
 tjost_module_schedule(Tjost_Module *module, jack_nframes_t time, size_t len, void *buf)
 {
-	Tjost_Event *tev = tjost_alloc(module->host, sizeof(Tjost_Event) + len);
+	if(_tjost_quota_charge(module->host, module, len))
+		return;
+
+	Tjost_Event *tev = tjost_module_queue_alloc(module, len);
+
+	if(!tev)
+	{
+		tjost_quota_release(module, len);
+		return;
+	}
 
+	tev->ref = 1;
 	tev->time = time;
 	tev->size = len;
-	tev->module = NULL;
+	tev->module = module; // marks the event as charged to this module's quota
 	memcpy(tev->buf, buf, len);
 
-	module->queue = eina_inlist_sorted_insert(module->queue, EINA_INLIST_GET(tev), _tjost_schedule_sort);
+	tjost_module_queue_push(module, tev);
 }
 
 void
 tjost_host_message_push(Tjost_Host *host, const char *fmt, ...)
 {
-	static char str [1024]; //TODO how big?
 	va_list argv;
 	va_start(argv, fmt);
-	vsprintf(str, fmt, argv);
+	int res = tjost_log_vpush(&host->log, fmt, argv);
 	va_end(argv);
 
-	size_t size = strlen(str) + 1;
-
-	if(jack_ringbuffer_write_space(host->rb_msg) < sizeof(size_t) + size)
-		; //FIXME report error
-	else
-	{
-		jack_ringbuffer_write(host->rb_msg, (const char *)&size, sizeof(size_t));
-		jack_ringbuffer_write(host->rb_msg, str, size);
-	}
-
-	int err;
-	if((err = uv_async_send(&host->msg)))
-		; //FIXME report error
+	// any thread may push, the wakeup list is real time thread only
+	if(!res)
+		__atomic_store_n(&host->msg_pending, 1, __ATOMIC_RELEASE);
 }
 
 int
-tjost_host_message_pull(Tjost_Host *host, char *str)
+tjost_host_message_pull(Tjost_Host *host, char *str, size_t size)
 {
-	if(jack_ringbuffer_read_space(host->rb_msg) >= sizeof(size_t))
-	{
-		size_t size;
-		jack_ringbuffer_peek(host->rb_msg, (char *)&size, sizeof(size_t));
-		if(jack_ringbuffer_read_space(host->rb_msg) >= sizeof(size_t) + size)
-		{
-			jack_ringbuffer_read_advance(host->rb_msg, sizeof(size_t));
-			jack_ringbuffer_read(host->rb_msg, str, size);
-			return 1;
-		}
-	}
-
-	return 0;
+	return tjost_log_pull(&host->log, str, size);
 }
 	
-//#define area_size 0x100000UL // 1MB
-#define area_size 0x1000000UL // 16MB
+static inline int
+_tjost_budget_exceeded(Tjost_Host *host)
+{
+	return host->budget.limit && (uv_hrtime() > host->budget.limit);
+}
+
+static inline void
+_tjost_budget_start(Tjost_Host *host, jack_nframes_t nframes)
+{
+	Tjost_Budget *budget = &host->budget;
 
-static Tjost_Mem_Chunk *
-tjost_map_memory_chunk(size_t size)
+	budget->start = uv_hrtime();
+	budget->limit = budget->fraction > 0.f
+		? budget->start + budget->fraction * nframes * 1e9 / host->srate
+		: 0;
+}
+
+static inline void
+_tjost_budget_end(Tjost_Host *host, jack_nframes_t nframes)
 {
-	void *area = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_32BIT|MAP_PRIVATE|MAP_ANONYMOUS|MAP_LOCKED, -1, 0);
+	Tjost_Budget *budget = &host->budget;
+	uint64_t elapsed = uv_hrtime() - budget->start;
 
-	if(area)
+	if(elapsed > budget->worst)
+		budget->worst = elapsed;
+
+	// report deferral about once a second
+	budget->frames += nframes;
+	if(budget->frames >= host->srate)
 	{
-		Tjost_Mem_Chunk *chunk = calloc(1, sizeof(Tjost_Mem_Chunk));
+		if(budget->deferred || budget->dropped)
+			tjost_host_message_push(host, "main loop: %u Lua callbacks deferred, %u dropped",
+				budget->deferred, budget->dropped);
 
-		chunk->size = size;
-		chunk->area = area;
-		return chunk;
+		budget->deferred = 0;
+		budget->dropped = 0;
+		budget->frames = 0;
 	}
-	else
-		return NULL;
-}
 
-static void
-tjost_unmap_memory_chunk(Tjost_Mem_Chunk *chunk)
-{
-	if(chunk)
+	// report worst cycle time on its own, less frequent schedule
+	budget->worst_frames += nframes;
+	if(budget->worst_frames >= TJOST_BUDGET_REPORT * host->srate)
 	{
-		//munmap(chunk->area, chunk->size); // done automatically at process end
-		free(chunk);
+		tjost_host_message_push(host, "main loop: worst cycle %i us", (int)(budget->worst / 1000));
+
+		budget->worst = 0;
+		budget->worst_frames = 0;
 	}
 }
 
-static void
-tjost_request_memory(uv_async_t *handle)
+// incremental Lua garbage collection in the slack left at the end of a period,
+// the step size follows the allocation rate and is cut to fit the remaining time
+static inline void
+_tjost_gc(Tjost_Host *host, jack_nframes_t nframes)
 {
-	Tjost_Host *host = handle->data;
-	Tjost_Mem_Chunk *chunk;
-
-	if(!(chunk = tjost_map_memory_chunk(area_size)))
-		fprintf(stderr, "tjost_request_memory: could not allocate RT memory chunk\n");
-	else
+	Tjost_Gc *gc = &host->gc;
+	lua_State *L = host->L;
+	uint64_t now = uv_hrtime();
+	uint64_t end = host->budget.start + gc->fraction * nframes * 1e9 / host->srate;
+	uint64_t slack = end > now ? end - now : 0;
+
+	// KB allocated since last step, includes debt of skipped periods
+	int debt = lua_gc(L, LUA_GCCOUNT, 0) - gc->count;
+	int step = debt;
+	if(step < gc->min)
+		step = gc->min;
+	if(gc->max && (step > gc->max))
+		step = gc->max;
+
+	// cut step to fit the slack, start small as long as the cost is unknown
+	if(gc->cost > 0.f)
 	{
-		if(jack_ringbuffer_write_space(host->rb_rtmem) < sizeof(uintptr_t))
-			fprintf(stderr, "tjost_request_memory: ring buffer overflow");
-		else
-			jack_ringbuffer_write(host->rb_rtmem, (const char *)&chunk, sizeof(uintptr_t));
+		if(step * gc->cost > slack)
+			step = slack / gc->cost;
 	}
-}
+	else
+		step = gc->min;
 
-static size_t used = 0;
+	// never let the Lua heap grow without bounds under persistent overload
+	if( (step < gc->min)
+		&& ( (gc->starved + 1 >= TJOST_GC_FORCE_PERIODS) || (debt >= TJOST_GC_FORCE_DEBT) ) )
+	{
+		step = gc->min;
+		gc->forced++;
+	}
 
-static void
-tjost_add_memory(Tjost_Host *host)
-{
-	if(jack_ringbuffer_read_space(host->rb_rtmem) >= sizeof(uintptr_t))
+	if(step < gc->min)
 	{
-		Tjost_Mem_Chunk *chunk;
+		gc->skipped++;
+		gc->starved++;
+	}
+	else
+	{
+		lua_gc(L, LUA_GCSTEP, step);
 
-		jack_ringbuffer_read(host->rb_rtmem, (char *)&chunk, sizeof(uintptr_t));
+		uint64_t elapsed = uv_hrtime() - now;
+		float cost = (float)elapsed / (step ? step : 1);
 
-		chunk->pool = tlsf_add_pool(host->tlsf, chunk->area, chunk->size);
-		host->rtmem_chunks = eina_inlist_prepend(host->rtmem_chunks, EINA_INLIST_GET(chunk));
-		host->rtmem_sum += chunk->size;
-		host->rtmem_flag = 0;
-		
-		tjost_host_message_push(host, "Rt memory extended to: 0x%x bytes", host->rtmem_sum);
+		gc->cost = gc->cost > 0.f ? 0.9f*gc->cost + 0.1f*cost : cost;
+		gc->count = lua_gc(L, LUA_GCCOUNT, 0);
+		gc->time += elapsed;
+		if(elapsed > gc->worst)
+			gc->worst = elapsed;
+		gc->starved = 0;
 	}
-}
 
-static void
-tjost_free_memory(Tjost_Host *host)
-{
-	Eina_Inlist *l;
-	Tjost_Mem_Chunk *chunk;
-	EINA_INLIST_FOREACH_SAFE(host->rtmem_chunks, l, chunk)
+	// report about once a second
+	gc->frames += nframes;
+	if(gc->frames >= host->srate)
 	{
-		tlsf_remove_pool(host->tlsf, chunk->pool);
-		host->rtmem_sum -= chunk->size;
-		host->rtmem_chunks = eina_inlist_remove(host->rtmem_chunks, EINA_INLIST_GET(chunk));
-		tjost_unmap_memory_chunk(chunk);
+		unsigned int periods = gc->frames / nframes;
+
+		gc->average = gc->time / (periods ? periods : 1);
+		if(gc->skipped || gc->forced)
+			tjost_host_message_push(host, "lua gc: %u periods without slack, %u forced steps, %i us per period, worst step %i us",
+				gc->skipped, gc->forced, (int)(gc->average / 1000), (int)(gc->worst / 1000));
+
+		gc->time = 0;
+		gc->worst = 0;
+		gc->skipped = 0;
+		gc->forced = 0;
+		gc->frames = 0;
 	}
 }
 
-void *
-tjost_alloc(Tjost_Host *host, size_t len)
+static inline void
+_tjost_defer(Tjost_Host *host, Tjost_Event *tev)
 {
-	void *data = NULL;
-	
-	if(!(data = tlsf_malloc(host->tlsf, len)))
-		tjost_host_message_push(host, "tjost_alloc: out of memory");
-
-	used += tlsf_block_size(data);
-
-	if( (host->rtmem_flag == 0) && (used > host->rtmem_sum/2) ) //TODO make this configurable
+	// drop oldest under sustained overload
+	if(host->ndeferred >= TJOST_DEFERRED_MAX)
 	{
-		host->rtmem_flag = 1;
-		uv_async_send(&host->rtmem);
+		Tjost_Event *old = EINA_INLIST_CONTAINER_GET(host->deferred, Tjost_Event);
+		host->deferred = eina_inlist_remove(host->deferred, EINA_INLIST_GET(old));
+		host->ndeferred--;
+		host->budget.dropped++;
+		tjost_event_unref(host, old);
 	}
 
-	return data;
+	host->deferred = eina_inlist_append(host->deferred, EINA_INLIST_GET(tjost_event_ref(tev)));
+	host->ndeferred++;
+	host->budget.deferred++;
 }
 
-void *
-tjost_realloc(Tjost_Host *host, size_t len, void *buf)
+// run Lua callbacks deferred in previous periods, as long as budget lasts
+static inline void
+_tjost_deferred_drain(Tjost_Host *host, jack_nframes_t last)
 {
-	void *data = NULL;
-	
-	used -= tlsf_block_size(buf);
-
-	if(!(data =tlsf_realloc(host->tlsf, buf, len)))
-		tjost_host_message_push(host, "tjost_realloc: out of memory");
-	
-	used += tlsf_block_size(data);
+	Tjost_Routing *routing = &host->routing;
+	unsigned int i;
 
-	if( (host->rtmem_flag == 0) && (used > host->rtmem_sum/2) ) //TODO make this configurable
+	while(host->deferred && !_tjost_budget_exceeded(host))
 	{
-		host->rtmem_flag = 1;
-		uv_async_send(&host->rtmem);
-	}
+		Tjost_Event *tev = EINA_INLIST_CONTAINER_GET(host->deferred, Tjost_Event);
+		host->deferred = eina_inlist_remove(host->deferred, EINA_INLIST_GET(tev));
+		host->ndeferred--;
+
+		if(tev->module == TJOST_MODULE_BROADCAST)
+		{
+			for(i=0; i<routing->nuplinks; i++)
+			{
+				Tjost_Module *uplink = routing->uplinks[i];
+
+				if(uplink->has_lua_callback && uplink->best_effort && !uplink->batch)
+					tjost_lua_deserialize(uplink, tev, last);
+			}
+		}
+		else
+			tjost_lua_deserialize(tev->module, tev, last); // event is shared, keep its time
 
-	return data;
+		tjost_event_unref(host, tev);
+	}
 }
 
-void
-tjost_free(Tjost_Host *host, void *buf)
+static inline void
+_tjost_flush(Tjost_Host *host, Tjost_Module *module)
 {
-	used -= tlsf_block_size(buf);
-	tlsf_free(host->tlsf, buf);
+	Tjost_Batch *batch = module->batch;
+
+	if(module->best_effort && batch && _tjost_budget_exceeded(host))
+	{
+		// keep batch for next period, count each callback once
+		host->budget.deferred += batch->count - batch->deferred;
+		batch->deferred = batch->count;
+	}
+	else
+		tjost_lua_flush(module);
 }
 
 static int
 _process(jack_nframes_t nframes, void *arg)
 {
 	Tjost_Host *host = arg;
+	Tjost_Routing *routing = &host->routing;
 	Tjost_Module *module;
-	Tjost_Child *child;
-	Tjost_Module *uplink;
+	unsigned int i, j;
 
 	jack_nframes_t last = jack_last_frame_time(host->client);
 
+	_tjost_budget_start(host, nframes);
+
 	// extend memory if requested
-	tjost_add_memory(host);
+	tjost_heap_add(host);
 
 	// receive from uplink ringbuffer
 	tjost_uplink_rx_drain(host, 0);
@@ -324,76 +434,121 @@ _process(jack_nframes_t nframes, void *arg)
 	// reset uplink TX message counter
 	host->pipe_uplink_tx_count = 0;
 
+	// recompile routing table if modules have been added or removed
+	if(routing->dirty)
+		tjost_routing_compile(host);
+
 	// receive on all inputs
-	EINA_INLIST_FOREACH(host->modules, module)
-		if(module->type & TJOST_MODULE_INPUT)
-			module->process_in(nframes, module);
+	for(i=0; i<routing->ninputs; i++)
+	{
+		module = routing->inputs[i];
+		module->process_in(nframes, module);
+	}
+
+	// handle Lua callbacks deferred in previous periods first to keep order
+	_tjost_deferred_drain(host, last);
 
 	// handle main queue events
-	Eina_Inlist *l;
 	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(host->queue, l, tev)
+	while((tev = tjost_queue_pop(&host->queue, last + nframes)))
 	{
-		if(tev->time >= last + nframes)
-			break;
-		else if(tev->time == 0) // immediate execution
+		tjost_quota_release(tev->module, tev->size);
+
+		if(tev->time == 0) // immediate execution
 			tev->time = last;
 		else if(tev->time < last)
 		{
-			tjost_host_message_push(host, "main loop: %s %i", "late event", tev->time - last);
+			tjost_host_message_push(host, "main loop: late event %i", tev->time - last);
 			tev->time = last;
 		}
 
+		int exceeded = _tjost_budget_exceeded(host);
+		int defer = 0;
+
 		if(tev->module == TJOST_MODULE_BROADCAST) // is uplink message
 		{
-			EINA_INLIST_FOREACH(host->uplinks, uplink)
+			for(i=0; i<routing->nuplinks; i++)
 			{
-				// send to all children modules
-				EINA_INLIST_FOREACH(uplink->children, child)
-					tjost_module_schedule(child->module, tev->time, tev->size, tev->buf);
+				Tjost_Module *uplink = routing->uplinks[i];
+
+				// send to all children modules, they share the event
+				for(j=0; j<uplink->ntargets; j++)
+					tjost_module_queue_push(uplink->targets[j], tjost_event_ref(tev));
 
-				// serialize to Lua callback function
+				// serialize to Lua callback function, batches are held by _tjost_flush instead
 				if(uplink->has_lua_callback)
 				{
-					tev->module = uplink;
-					tjost_lua_deserialize(tev);
+					if(exceeded && uplink->best_effort && !uplink->batch)
+						defer = 1;
+					else
+						tjost_lua_deserialize(uplink, tev, tev->time);
 				}
 			}
 		}
 		else // != TJOST_MODULE_BROADCAST
 		{
-			// send to all children modules
-			EINA_INLIST_FOREACH(tev->module->children, child)
-				tjost_module_schedule(child->module, tev->time, tev->size, tev->buf);
-
-			// serialize to Lua callback function
-			if(tev->module->has_lua_callback)
+			// send to all children modules, they share the event
+			for(j=0; j<tev->module->ntargets; j++)
+				tjost_module_queue_push(tev->module->targets[j], tjost_event_ref(tev));
+
+			// forward to native path router, unmatched paths fall back to Lua
+			Tjost_Module *target = NULL;
+			if(tev->module->route && (tev->buf[0] == '/'))
+				target = tjost_router_lookup(tev->module->route, (const char *)tev->buf);
+
+			if(target)
+				tjost_module_queue_push(target, tjost_event_ref(tev));
+			// serialize to Lua callback function, batches are held by _tjost_flush instead
+			else if(tev->module->has_lua_callback && exceeded && tev->module->best_effort && !tev->module->batch)
+				defer = 1;
+			else if(tev->module->has_lua_callback)
 			{
 				//tjost_host_message_push(host, "main loop: Lua logic for %p", tev->module);
-				tjost_lua_deserialize(tev);
+				tjost_lua_deserialize(tev->module, tev, tev->time);
 			}
 		}
 
-		host->queue = eina_inlist_remove(host->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
+		if(defer)
+			_tjost_defer(host, tev);
+
+		tjost_event_unref(host, tev); // freed here if not shared with any child
 	}
 
+	// deliver batched events to Lua callback functions
+	for(i=0; i<routing->ninputs; i++)
+		_tjost_flush(host, routing->inputs[i]);
+	for(i=0; i<routing->nuplinks; i++)
+		_tjost_flush(host, routing->uplinks[i]);
+
 	// send on all outputs
-	EINA_INLIST_FOREACH(host->modules, module)
-		if(module->type & TJOST_MODULE_OUTPUT)
-			module->process_out(nframes, module);
+	for(i=0; i<routing->noutputs; i++)
+	{
+		module = routing->outputs[i];
+		module->process_out(nframes, module);
+	}
 
 	// send on all uplinks
-	EINA_INLIST_FOREACH(host->uplinks, module)
+	for(i=0; i<routing->nuplinks; i++)
+	{
+		module = routing->uplinks[i];
 		module->process_out(nframes, module);
+	}
 
 	// write uplink events to rinbbuffer
 	if(host->pipe_uplink_tx_count > 0)
-		if(tjost_pipe_flush(&host->pipe_uplink_tx))
-			tjost_host_message_push(host, "tjost_pipe_flush failed");
+		tjost_host_wakeup(host, &host->pipe_uplink_tx.wake, NULL);
+
+	// report heap fragmentation to uplinks, if there is time left
+	if(!_tjost_budget_exceeded(host))
+		tjost_heap_report(host, nframes);
+
+	// run garbage collection in what is left of the period
+	_tjost_gc(host, nframes);
 
-	// run garbage collection step
-	lua_gc(host->L, LUA_GCSTEP, 0); //TODO check if needed
+	// signal main loop consumers, once per period at most
+	tjost_host_wakeup_flush(host, last + nframes);
+
+	_tjost_budget_end(host, nframes);
 	
 	return 0;
 }
@@ -410,15 +565,16 @@ _tjost_init(uv_loop_t *loop, Tjost_Host *host, int argc, const char **argv)
 	// init Non Session Management
 	const char *id = tjost_nsm_init(argc, argv);
 	
-	// init memory pool
-	Tjost_Mem_Chunk *chunk;
-	if(!(chunk = tjost_map_memory_chunk(area_size)))
-		FAIL("could not allocate RT memory chunk\n");
-	if(!(host->tlsf = tlsf_create_with_pool(chunk->area, chunk->size)))
-		FAIL("could not initialize TLSF memory pool\n");
-	chunk->pool = tlsf_get_pool(host->tlsf);
-	host->rtmem_chunks = eina_inlist_prepend(host->rtmem_chunks, EINA_INLIST_GET(chunk));
-	host->rtmem_sum = area_size;
+	// init memory pools
+	if(tjost_heap_init(host, TJOST_HEAP_STATIC, TJOST_HEAP_STATIC_SIZE))
+		FAIL("could not initialize static RT memory pool\n");
+	if(tjost_heap_init(host, TJOST_HEAP_EVENT, TJOST_HEAP_EVENT_SIZE))
+		FAIL("could not initialize event RT memory pool\n");
+	if(tjost_heap_init(host, TJOST_HEAP_LUA, TJOST_HEAP_LUA_SIZE))
+		FAIL("could not initialize Lua RT memory pool\n");
+
+	// init event size classes
+	tjost_slab_init(&host->slab);
 	
 	// init jack
 	host->server_name = NULL; //FIXME
@@ -450,23 +606,38 @@ _tjost_init(uv_loop_t *loop, Tjost_Host *host, int argc, const char **argv)
 #endif // HAS_METADATA_API
 
 	// init pipes
-	if(tjost_pipe_init(&host->pipe_uplink_rx))
+	if(tjost_pipe_init_mpsc(&host->pipe_uplink_rx, NULL))
 		FAIL("could not initialize uplink RX pipe\n");
-	if(tjost_pipe_init(&host->pipe_uplink_tx))
+	if(tjost_pipe_init(&host->pipe_uplink_tx, NULL))
 		FAIL("could not initialize uplink TX pipe\n");
 	if(tjost_pipe_listen_start(&host->pipe_uplink_tx, loop,
-			tjost_uplink_tx_drain_alloc, tjost_uplink_tx_drain_sched, NULL))
+			NULL, tjost_uplink_tx_drain_sched, NULL))
 		FAIL("could not initialize listening on uplink RX pipe\n");
 
-	// init message ringbuffer
-	if(!(host->rb_msg = jack_ringbuffer_create(TJOST_RINGBUF_SIZE)))
-		FAIL("could not initialize ringbuffer\n");
+	// init message log
+	tjost_log_init(&host->log);
 	// init realtime memory ringbuffer
 	if(!(host->rb_rtmem = jack_ringbuffer_create(sizeof(Tjost_Mem_Chunk)*2+1)))
 		FAIL("could not initialize ringbuffer\n");
+	if(!(host->rb_rtmem_release = jack_ringbuffer_create(sizeof(Tjost_Mem_Chunk)*2+1)))
+		FAIL("could not initialize ringbuffer\n");
 
 	host->srate = jack_get_sample_rate(host->client);
 
+	// init cycle budget, may be changed from Lua
+	host->budget.fraction = TJOST_BUDGET_FRACTION;
+
+	// init Lua watchdog with a time limit derived from the period, may be changed from Lua
+	host->watchdog.time = TJOST_WATCHDOG_FRACTION * jack_get_buffer_size(host->client) * 1e9 / host->srate;
+
+	// init Lua garbage collection, may be changed from Lua
+	host->gc.fraction = TJOST_GC_FRACTION;
+	host->gc.min = TJOST_GC_STEP_MIN;
+	host->gc.max = TJOST_GC_STEP_MAX;
+
+	// init main queue with slots as wide as a period
+	tjost_queue_init(&host->queue, jack_get_buffer_size(host->client));
+
 	// init and load modules
 	host->mod_path = NULL; //FIXME
 	host->arr = eina_module_list_get(NULL, "/usr/local/lib/tjost", EINA_FALSE, NULL, NULL);
@@ -502,7 +673,7 @@ _tjost_init(uv_loop_t *loop, Tjost_Host *host, int argc, const char **argv)
 		FAIL("uv error: %s\n", uv_err_name(err));
 
 	host->rtmem.data = host;
-	if((err = uv_async_init(loop, &host->rtmem, tjost_request_memory)))
+	if((err = uv_async_init(loop, &host->rtmem, tjost_heap_request)))
 		FAIL("uv error: %s\n", uv_err_name(err));
 
 	char *sep = strrchr(argv[1], '/');
@@ -526,9 +697,13 @@ _tjost_init(uv_loop_t *loop, Tjost_Host *host, int argc, const char **argv)
 	// load file
 	if(argv[1] && luaL_dofile(host->L, argv[1]))
 		FAIL("error loading file: %s\n", lua_tostring(host->L, -1));
-	lua_gc(host->L, LUA_GCSTOP, 0); // disable automatic garbage collection
+	lua_gc(host->L, LUA_GCSTOP, 0); // disable automatic garbage collection, stepped in _process
+	host->gc.count = lua_gc(host->L, LUA_GCCOUNT, 0);
 
 	tjost_lua_deregister(host);
+
+	// module graph is static from here on
+	tjost_routing_compile(host);
 	
 	// activate JACK
 	if(jack_activate(host->client))
@@ -546,6 +721,8 @@ _tjost_deinit(Tjost_Host *host)
 
 	// deinit Lua
 	tjost_lua_deinit(host);
+	if(host->heaps[TJOST_HEAP_STATIC].tlsf)
+		tjost_routing_deinit(host);
 
 	// deinit libuv
 	uv_close((uv_handle_t *)&host->rtmem, NULL);
@@ -560,15 +737,27 @@ _tjost_deinit(Tjost_Host *host)
 	if((err = uv_signal_stop(&host->sigquit)))
 		fprintf(stderr, "uv error: %s\n", uv_err_name(err));
 
-	// drain main queue
-	Eina_Inlist *l;
-	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(host->queue, l, tev)
+	// drain main queue and deferred events
+	if(host->heaps[TJOST_HEAP_EVENT].tlsf)
 	{
-		host->queue = eina_inlist_remove(host->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
+		tjost_queue_clear(&host->queue, host);
+
+		Eina_Inlist *l;
+		Tjost_Event *tev;
+		EINA_INLIST_FOREACH_SAFE(host->deferred, l, tev)
+		{
+			host->deferred = eina_inlist_remove(host->deferred, EINA_INLIST_GET(tev));
+			tjost_event_free(host, tev);
+		}
+		host->ndeferred = 0;
 	}
 
+	// print messages pushed after the last period
+	_msg(&host->msg);
+
+	// report message counts, before modules holding the format strings are unloaded
+	tjost_log_summary(&host->log);
+
 	// unload, deinit and free modules
 	if(host->arr)
 	{
@@ -590,10 +779,10 @@ _tjost_deinit(Tjost_Host *host)
 		jack_ringbuffer_free(host->rb_rtmem);
 		host->rb_rtmem = NULL;
 	}
-	if(host->rb_msg)
+	if(host->rb_rtmem_release)
 	{
-		jack_ringbuffer_free(host->rb_msg);
-		host->rb_msg = NULL;
+		jack_ringbuffer_free(host->rb_rtmem_release);
+		host->rb_rtmem_release = NULL;
 	}
 
 	// deinit pipes
@@ -619,12 +808,11 @@ _tjost_deinit(Tjost_Host *host)
 	}
 
 	// deinit Rt memory pool
-	if(host->tlsf)
-	{
-		tjost_free_memory(host);
-		tlsf_destroy(host->tlsf);
-		host->tlsf = NULL;
-	}
+	if(host->heaps[TJOST_HEAP_EVENT].tlsf)
+		tjost_slab_deinit(host);
+	tjost_heap_deinit(host, TJOST_HEAP_LUA);
+	tjost_heap_deinit(host, TJOST_HEAP_EVENT);
+	tjost_heap_deinit(host, TJOST_HEAP_STATIC);
 
 	// deinit Non Session Management
 	tjost_nsm_deinit();
@@ -51,13 +51,63 @@ extern "C" {
 
 typedef struct _Tjost_Midi Tjost_Midi;
 typedef struct _Tjost_Blob Tjost_Blob;
+typedef struct _Tjost_View Tjost_View;
+typedef struct _Tjost_Views Tjost_Views;
 typedef struct _Tjost_Bundle Tjost_Bundle;
+typedef struct _Tjost_Serializer Tjost_Serializer;
 typedef struct _Tjost_Event Tjost_Event;
 typedef struct _Tjost_Module Tjost_Module;
 typedef struct _Tjost_Child Tjost_Child;
 typedef struct _Tjost_Mem_Chunk Tjost_Mem_Chunk;
 typedef struct _Tjost_Host Tjost_Host;
 typedef struct _Tjost_Pipe Tjost_Pipe;
+typedef struct _Tjost_Pipe_Record Tjost_Pipe_Record;
+typedef struct _Tjost_Queue Tjost_Queue;
+typedef struct _Tjost_Module_Queue Tjost_Module_Queue;
+typedef struct _Tjost_Routing Tjost_Routing;
+typedef struct _Tjost_Batch Tjost_Batch;
+typedef struct _Tjost_Route Tjost_Route;
+typedef struct _Tjost_Router Tjost_Router;
+typedef union _Tjost_Log_Arg Tjost_Log_Arg;
+typedef struct _Tjost_Log_Record Tjost_Log_Record;
+typedef struct _Tjost_Log_Id Tjost_Log_Id;
+typedef struct _Tjost_Log Tjost_Log;
+typedef struct _Tjost_Budget Tjost_Budget;
+typedef struct _Tjost_Watchdog Tjost_Watchdog;
+typedef struct _Tjost_Gc Tjost_Gc;
+typedef struct _Tjost_Slab_Class Tjost_Slab_Class;
+typedef struct _Tjost_Slab Tjost_Slab;
+typedef struct _Tjost_Heap Tjost_Heap;
+typedef struct _Tjost_Heap_Stats Tjost_Heap_Stats;
+typedef struct _Tjost_Quota Tjost_Quota;
+typedef struct _Tjost_Wakeup Tjost_Wakeup;
+typedef struct _Tjost_Pipe_Stats Tjost_Pipe_Stats;
+typedef struct _Tjost_Pipe_Latest Tjost_Pipe_Latest;
+
+typedef enum _Tjost_Quota_Policy {
+	TJOST_QUOTA_DROP, // reject events over quota
+	TJOST_QUOTA_WARN // accept and count events over quota
+} Tjost_Quota_Policy;
+
+typedef enum _Tjost_Pipe_Policy {
+	TJOST_PIPE_DROP_NEWEST, // reject records when full
+	TJOST_PIPE_DROP_OLDEST, // consumer discards backlog queued before an overflow
+	TJOST_PIPE_COALESCE, // consumer only delivers the latest pending message per path
+	TJOST_PIPE_BLOCK // producer waits for space, non real time producers only
+} Tjost_Pipe_Policy;
+
+typedef enum _Tjost_Heap_Id {
+	TJOST_HEAP_STATIC,
+	TJOST_HEAP_EVENT,
+	TJOST_HEAP_LUA,
+	TJOST_HEAP_MAX
+} Tjost_Heap_Id;
+
+typedef enum _Tjost_Heap_Flag {
+	TJOST_HEAP_IDLE,
+	TJOST_HEAP_REQUESTED, // by real time thread
+	TJOST_HEAP_PENDING // chunk mapped by main loop, in transit
+} Tjost_Heap_Flag;
 
 typedef int (*Tjost_Module_Add_Cb)(Tjost_Module *module);
 typedef void (*Tjost_Module_Del_Cb)(Tjost_Module *module);
@@ -74,6 +124,45 @@ typedef int (*Tjost_Pipe_Sched_Cb)(Tjost_Event *tev, osc_data_t *buf, void *arg)
 #define TJOST_BUF_SIZE (0x4000)
 #define OSC_STREAM_BUF(TJOST_BUF_SIZ)
 #define TJOST_RINGBUF_SIZE (0x10000)
+#define TJOST_PIPE_SOURCES (0x100) // distinct source modules per pipe
+#define TJOST_PIPE_LATEST (0x40) // paths tracked per pass of coalescing pipes, must be a power of two
+#define TJOST_PIPE_BLOCK_MAX (1000) // max ms a blocking producer waits for space
+#define TJOST_QUEUE_SLOTS (0x100) // must be a power of two
+#define TJOST_MODULE_QUEUE_SIZE (0x40) // initial event slots per module
+#define TJOST_MODULE_ARENA_SIZE (0x1000) // bump allocated event storage per module
+#define TJOST_MODULE_NAME_SIZE (0x20) // plugin name kept for messages
+#define TJOST_BATCH_SIZE (0x40) // initial event slots per batch
+#define TJOST_BATCH_DEPTH (8) // max bundle nesting for batch iteration
+#define TJOST_ROUTER_DEPTH (16) // max path components considered for prefix routes
+#define TJOST_LOG_SLOTS (0x200) // log records in flight, must be a power of two
+#define TJOST_LOG_ARGS (8) // max arguments per log record
+#define TJOST_LOG_STR_SIZE (0x100) // storage for string arguments per log record
+#define TJOST_LOG_IDS (0x80) // distinct message ids with counters, must be a power of two
+#define TJOST_LOG_RATE (8) // max records per message id and second
+#define TJOST_LOG_LINE_SIZE (0x400) // max length of formatted log line
+#define TJOST_BUDGET_FRACTION (0.75) // default share of a period for event handling
+#define TJOST_BUDGET_REPORT (10) // s between reports of worst cycle time
+#define TJOST_DEFERRED_MAX (0x400) // max events with deferred Lua callbacks, oldest are dropped
+#define TJOST_WATCHDOG_FRACTION (0.5) // default max share of a period per Lua callback
+#define TJOST_WATCHDOG_STEP (0x400) // Lua instructions between watchdog checks
+#define TJOST_GC_FRACTION (0.9) // default share of a period Lua garbage collection may run up to
+#define TJOST_GC_STEP_MIN (1) // smallest Lua garbage collection step in KB
+#define TJOST_GC_STEP_MAX (0x100) // largest Lua garbage collection step in KB
+#define TJOST_GC_FORCE_PERIODS (0x40) // periods without slack before a smallest step is forced
+#define TJOST_GC_FORCE_DEBT (0x800) // KB allocated since last step forcing a smallest step
+#define TJOST_SLAB_MIN (64) // smallest event size class, must be a power of two
+#define TJOST_SLAB_CLASSES (4) // event size classes 64, 128, 256 and 512 bytes
+#define TJOST_SLAB_PAGE_SIZE (0x4000) // carved from Rt memory pool per slab refill
+#define TJOST_HEAP_STATIC_SIZE (0x400000) // 4MB for modules and host structures
+#define TJOST_HEAP_EVENT_SIZE (0x1000000) // 16MB for event traffic
+#define TJOST_HEAP_LUA_SIZE (0x1000000) // 16MB for Lua
+#define TJOST_HEAP_HIGH (0.5) // default usage share of a heap triggering growth
+#define TJOST_HEAP_LOW (0.125) // default usage share of a heap allowing release of chunks
+#define TJOST_HEAP_SHRINK_PERIODS (0x400) // periods between checks for releasable chunks
+#define TJOST_HEAP_CHUNKS (0x100) // max chunks per heap
+#define TJOST_HUGE_PAGE_SIZE (0x200000) // 2MB
+#define TJOST_WAKEUP_SLOTS (0x40) // consumers signalled at end of period, more are signalled right away
+#define TJOST_WAKEUP_LATENCY (0.1) // default max latency in s of consumers with a fill level
 
 #define MOD_ADD_ERR(HOST, NAME, MSG) \
 ({ \
@@ -90,42 +179,132 @@ struct _Tjost_Blob {
 	uint8_t buf[0];
 };
 
+// borrowed blob or MIDI argument, points into the event buffer while a callback runs
+struct _Tjost_View {
+	int32_t size; // 0 once expired
+	uint8_t *buf; // NULL once expired
+	int midi;
+};
+
+struct _Tjost_Views {
+	int ref; // registry table of reusable view userdata
+	unsigned int used; // views handed out to current callback
+};
+
 struct _Tjost_Bundle {
 	EINA_INLIST;
 
 	osc_data_t *ptr;
 };
 
+struct _Tjost_Serializer {
+	osc_data_t *ptr;
+	osc_data_t *itm;
+	Eina_Inlist *bndls;
+	osc_data_t buf [0];
+};
+
 struct _Tjost_Event {
 	EINA_INLIST;
 
 	Tjost_Module *module; // destination
 
+	int ref; // shared by fan-out to child modules
 	jack_nframes_t time;
 	size_t size;
 	osc_data_t buf [0];
 };
 
+struct _Tjost_Module_Queue {
+	Tjost_Event **evs; // time ordered
+	unsigned int head; // first pending event
+	unsigned int tail; // one past last pending event
+	unsigned int size;
+
+	osc_data_t *arena; // bump allocated, reset when queue runs empty
+	size_t arena_used;
+	size_t arena_size;
+};
+
+typedef enum _Tjost_Batch_Mode {
+	TJOST_BATCH_PERIOD,
+	TJOST_BATCH_BUNDLE
+} Tjost_Batch_Mode;
+
+struct _Tjost_Batch {
+	Tjost_Module *module;
+	Tjost_Batch_Mode mode;
+	int ref; // registry reference of this userdata
+
+	Tjost_Event **evs; // pending events, shared with child modules
+	unsigned int count;
+	unsigned int size;
+	unsigned int deferred; // pending events already counted as deferred
+
+	// iterator state
+	unsigned int idx;
+	jack_nframes_t time;
+	int depth;
+	osc_data_t *ptr [TJOST_BATCH_DEPTH];
+	osc_data_t *end [TJOST_BATCH_DEPTH];
+};
+
+struct _Tjost_Route {
+	uint32_t hash;
+	size_t len;
+	const char *path;
+	Tjost_Module *target;
+};
+
+struct _Tjost_Router {
+	int ref; // Lua registry reference to route table, keeps targets alive
+	unsigned int count;
+	unsigned int mask;
+	char *strings; // next free byte in path storage
+	Tjost_Route routes [0]; // open addressing hash table, followed by path storage
+};
+
+struct _Tjost_Quota {
+	size_t limit; // max bytes of queued events, 0 for unlimited
+	size_t used; // bytes of queued events
+	size_t peak;
+	Tjost_Quota_Policy policy;
+	unsigned int dropped; // events rejected over quota
+	unsigned int exceeded; // events accepted over quota
+};
+
 struct _Tjost_Module {
 	EINA_INLIST;
 
-	Tjost_Module_Add_Cb add;
-	Tjost_Module_Del_Cb del;
+	// hot, touched every period
 	JackProcessCallback process_in;
 	JackProcessCallback process_out;
-
-	int type;
 	Tjost_Host *host;
 	void *dat;
-
-	Eina_Inlist *queue; // module output event queue
-	Eina_Inlist *children; // child modules for direct mode
+	int type;
 	int has_lua_callback;
-
-	osc_data_t buffer [TJOST_BUF_SIZE];
-	osc_data_t *buf_ptr;
-	osc_data_t *itm;
-	Eina_Inlist *bndls;
+	int best_effort; // Lua callback may be deferred when cycle budget is exhausted
+	int borrow; // blob and MIDI arguments are views valid during Lua callback
+	Tjost_Module **targets; // compiled children, points into routing table
+	unsigned int ntargets;
+	Tjost_Router *route; // native path router ahead of Lua callback, optional
+	Tjost_Batch *batch; // batched delivery to Lua callback, optional
+	Tjost_Module_Queue queue; // module output event queue
+	Tjost_Quota quota; // bytes of events queued by this module
+
+	// cold
+	char name [TJOST_MODULE_NAME_SIZE]; // plugin name
+	Tjost_Module_Add_Cb add;
+	Tjost_Module_Del_Cb del;
+	Eina_Inlist *children; // child modules for direct mode
+	int strikes; // watchdog violations of Lua callback
+	size_t pipe_size; // capacity of pipes, 0 for default
+	Tjost_Pipe_Policy pipe_policy; // what pipes do when full
+	Eina_Inlist *pipes; // of this module, for telemetry
+	size_t wakeup_fill; // pending bytes before consumer is woken up, 0 for every period
+	jack_nframes_t wakeup_latency; // max frames before consumer is woken up, 0 for every period
+	size_t ser_size; // size of serialization buffer
+	Tjost_Serializer *ser; // allocated on first call from Lua
 };
 
 struct _Tjost_Child {
@@ -137,19 +316,211 @@ struct _Tjost_Child {
 struct _Tjost_Mem_Chunk {
 	EINA_INLIST;
 
+	Tjost_Heap *heap;
 	size_t size;
 	void *area;
 	pool_t pool;
+	size_t live; // bytes allocated from this chunk, atomic, releasable at zero
+	int fixed; // cannot be released
+};
+
+// compact header of records in ring buffers, the in-memory Tjost_Event is not sent over the wire
+struct _Tjost_Pipe_Record {
+	jack_nframes_t time;
+	uint16_t size;
+	uint16_t source; // index into source table of pipe
+	osc_data_t buf [0];
+};
+
+struct _Tjost_Wakeup {
+	uv_async_t *async; // consumer to signal
+	jack_ringbuffer_t *rb; // pending data for fill level, optional
+	Tjost_Host *host;
+	Tjost_Module *module; // wakeup configuration, NULL for urgent
+	int queued; // until end of period or until fill level or latency is reached
+	jack_nframes_t since; // when first queued
+};
+
+struct _Tjost_Pipe_Stats {
+	size_t high; // fill high-water mark in bytes
+	size_t produced; // records
+	size_t bytes; // payload bytes of produced records
+	size_t dropped; // records rejected by producer
+	size_t discarded; // records skipped by consumer
+};
+
+struct _Tjost_Pipe_Latest {
+	uint32_t hash;
+	Tjost_Pipe_Record *rec; // latest pending message with this path
+	size_t pos; // of rec, stale once consumer has passed it
 };
 
 struct _Tjost_Pipe {
+	EINA_INLIST;
+
 	jack_ringbuffer_t *rb;
+	Tjost_Module *module; // owner, optional
+	Tjost_Pipe_Policy policy;
+	int mpsc; // multiple producers, see tjost_pipe_init_mpsc
+	Tjost_Pipe_Stats stats; // updated with relaxed atomics, read from any thread
+
+	// tx
+	Tjost_Pipe_Record *slot; // pending reservation
+	size_t pad; // bytes skipped at end of ring by pending reservation
+	size_t tx_pos; // bytes written since init, claimed concurrently by multiple producers
+	size_t trim; // consumer discards everything before, for drop-oldest policy
+
+	// source modules, appended by producers only and published together with the first record referencing them
+	Tjost_Module *sources [TJOST_PIPE_SOURCES];
+	int retired; // entries of deleted modules wait to be freed, see tjost_pipe_forget
 
 	// rx
 	uv_async_t asio;
+	Tjost_Wakeup wake;
 	Tjost_Pipe_Alloc_Cb alloc_cb;
 	Tjost_Pipe_Sched_Cb sched_cb;
 	void *arg;
+	size_t rx_pos; // bytes read since init, producers of multi-producer pipes wait for it
+	size_t latest_end; // end of current coalescing pass
+	Tjost_Pipe_Latest latest [TJOST_PIPE_LATEST];
+};
+
+struct _Tjost_Queue {
+	Eina_Inlist *slots [TJOST_QUEUE_SLOTS]; // calendar wheel, one slot per period
+	Eina_Inlist *overflow; // far-future events beyond the wheel
+	Eina_Inlist *immediate; // FIFO lane for events without timestamp
+	jack_nframes_t cursor; // start time of current slot
+	unsigned int shift; // log2 of slot width in frames
+	unsigned int count; // events on the wheel
+};
+
+struct _Tjost_Routing {
+	Tjost_Module **table; // contiguous storage for all arrays below
+
+	Tjost_Module **inputs;
+	unsigned int ninputs;
+	Tjost_Module **outputs;
+	unsigned int noutputs;
+	Tjost_Module **uplinks;
+	unsigned int nuplinks;
+
+	int dirty; // recompile before next period
+};
+
+union _Tjost_Log_Arg {
+	int64_t h;
+	double d;
+	const void *p;
+	size_t s; // offset into record string storage
+};
+
+struct _Tjost_Log_Record {
+	unsigned int seq; // slot sequence number, synchronizes producers and consumer
+	const char *fmt; // message id, must be a string literal
+	unsigned int suppressed; // records dropped by rate limiting before this one
+	int argc;
+	Tjost_Log_Arg argv [TJOST_LOG_ARGS];
+	char str [TJOST_LOG_STR_SIZE];
+};
+
+struct _Tjost_Log_Id {
+	const char *fmt;
+	uint64_t window; // current rate limiting window
+	unsigned int count; // records in current window
+	unsigned int suppressed; // records dropped and not yet reported
+	unsigned int total;
+};
+
+struct _Tjost_Log {
+	Tjost_Log_Record slots [TJOST_LOG_SLOTS]; // bounded multi-producer ring
+	unsigned int tail; // next slot to claim by producers
+	unsigned int head; // next slot to read by consumer
+	unsigned int lost; // records dropped because ring was full
+	Tjost_Log_Id ids [TJOST_LOG_IDS]; // open addressing by message id
+};
+
+struct _Tjost_Budget {
+	float fraction; // share of period available for event handling, 0 for unlimited
+	uint64_t start; // start of current cycle in ns
+	uint64_t limit; // end of budget of current cycle in ns
+	uint64_t worst; // worst cycle time in ns since last report
+	jack_nframes_t worst_frames; // frames since last report of worst cycle time
+	unsigned int deferred; // Lua callbacks deferred since last report
+	unsigned int dropped; // deferred Lua callbacks dropped since last report
+	jack_nframes_t frames; // frames since last report
+};
+
+struct _Tjost_Gc {
+	float fraction; // share of period Lua garbage collection may run up to
+	int min; // smallest step in KB, smaller steps are skipped
+	int max; // largest step in KB, 0 for unlimited
+	int count; // Lua heap in KB after last step
+	float cost; // moving average of step cost in ns per KB
+	uint64_t time; // time spent in steps since last report in ns
+	uint64_t worst; // worst step time since last report in ns
+	unsigned int skipped; // periods without slack since last report
+	unsigned int forced; // steps forced despite missing slack since last report
+	unsigned int starved; // consecutive periods without step
+	jack_nframes_t frames; // frames since last report
+	uint64_t average; // step time per period of last report interval in ns
+};
+
+struct _Tjost_Watchdog {
+	int instructions; // max Lua instructions per callback, 0 for unlimited
+	uint64_t time; // max time per callback in ns, 0 for unlimited
+	int strikes; // violations until a responder is disabled, 0 for never
+
+	// state of running callback
+	int armed; // hook is installed once, it only checks limits inside callbacks
+	int step;
+	int count;
+	uint64_t deadline;
+	int tripped;
+};
+
+struct _Tjost_Slab_Class {
+	void *free; // free list, linked through first word of object
+	size_t size; // object size
+	unsigned int used; // objects handed out
+	unsigned int avail; // objects on free list
+	unsigned int pages; // pages carved for this class
+};
+
+struct _Tjost_Slab {
+	Tjost_Slab_Class classes [TJOST_SLAB_CLASSES];
+	void *pages; // all pages, linked through first word
+	unsigned int large; // live events too big for any class
+};
+
+struct _Tjost_Heap {
+	const char *name;
+	tlsf_t tlsf;
+	Eina_Inlist *chunks; // newest first
+	Tjost_Mem_Chunk *ranges [TJOST_HEAP_CHUNKS]; // same chunks sorted by address, for lookup of blocks
+	unsigned int nchunks;
+	// growth policy
+	size_t step; // growth step
+	size_t reserve; // never shrink below
+	size_t max; // never grow beyond, 0 for unlimited
+	float high; // usage share triggering growth
+	float low; // usage share allowing release of free chunks
+	int hugetlb; // back new chunks with huge pages
+	int lowmem; // map chunks into the lower 2GB
+
+	size_t sum; // mapped bytes
+	size_t used; // allocated bytes, atomic
+	unsigned int blocks; // allocated blocks, atomic
+	size_t peak; // atomic
+	unsigned int failed; // failed allocations, atomic
+	int flag; // Tjost_Heap_Flag, shared between real time thread and main loop
+};
+
+struct _Tjost_Heap_Stats {
+	size_t used; // bytes in used blocks
+	size_t free; // bytes in free blocks, without TLSF overhead
+	size_t largest; // largest free block, to within a TLSF size class
+	unsigned int nused; // used blocks
+	float fragmentation; // 1 - largest/free
 };
 
 struct _Tjost_Host {
@@ -164,26 +535,41 @@ struct _Tjost_Host {
 	uv_signal_t sigquit;
 	uv_async_t quit;
 
-	jack_ringbuffer_t *rb_msg;
+	Tjost_Log log; // binary message log, formatted on main loop
 	uv_async_t msg;
+	int msg_pending; // records pushed from any thread, main loop is signalled at end of period, atomic
+
+	Tjost_Wakeup *wakeups [TJOST_WAKEUP_SLOTS]; // coalesced consumer signals
+	unsigned int nwakeups;
 
 	int pipe_uplink_tx_count;
 	Tjost_Pipe pipe_uplink_tx;
 	Tjost_Pipe pipe_uplink_rx;
 
 	jack_ringbuffer_t *rb_rtmem;
+	jack_ringbuffer_t *rb_rtmem_release;
 	uv_async_t rtmem;
-	Eina_Inlist *rtmem_chunks;
-	size_t rtmem_sum;
-	int rtmem_flag;
-	tlsf_t tlsf;
+	unsigned int rtmem_tick;
+	jack_nframes_t heap_report; // frames between heap reports to uplinks, 0 for none
+	jack_nframes_t heap_report_frames;
+	int heap_report_next;
+	Tjost_Heap heaps [TJOST_HEAP_MAX]; // separate Rt memory pools
 
 	Eina_Array *arr; // modules
 
 	Eina_Inlist *modules; // input module instances
 	Eina_Inlist *uplinks; // uplink module instances
-
-	Eina_Inlist *queue; // host event queue
+	Tjost_Routing routing; // compiled from modules and uplinks
+
+	Tjost_Queue queue; // host event queue
+	Eina_Inlist *deferred; // events with deferred Lua callbacks of best-effort modules
+	unsigned int ndeferred;
+	Tjost_Budget budget; // per cycle time budget
+	Tjost_Watchdog watchdog; // per callback limits for Lua responders
+	Tjost_Gc gc; // Lua garbage collection in slack of period
+	Tjost_Views views; // borrowed blob and MIDI arguments
+	Tjost_Slab slab; // size class allocator for events
+	osc_data_t sink [TJOST_BUF_SIZE]; // filled in place of inline events dropped over quota
 
 	char *server_name;
 	char *mod_path;
@@ -192,30 +578,94 @@ struct _Tjost_Host {
 #endif
 };
 
-// in tjost.c
-void *tjost_alloc(Tjost_Host *host, size_t len);
+// in tjost_heap.c
+int tjost_heap_init(Tjost_Host *host, Tjost_Heap_Id id, size_t size);
+void tjost_heap_deinit(Tjost_Host *host, Tjost_Heap_Id id);
+Tjost_Heap *tjost_heap_find(Tjost_Host *host, const char *name);
+int tjost_heap_reserve(Tjost_Host *host, Tjost_Heap *heap, size_t size);
+void tjost_heap_stats(Tjost_Heap *heap, Tjost_Heap_Stats *stats);
+void tjost_heap_report(Tjost_Host *host, jack_nframes_t nframes);
+void tjost_heap_request(uv_async_t *handle);
+void tjost_heap_add(Tjost_Host *host);
+void *tjost_heap_alloc(Tjost_Host *host, Tjost_Heap_Id id, size_t len);
+void *tjost_heap_realloc(Tjost_Host *host, Tjost_Heap_Id id, size_t len, void *buf);
+void tjost_heap_free(Tjost_Host *host, Tjost_Heap_Id id, void *buf);
+void *tjost_alloc(Tjost_Host *host, size_t len); // from static heap
 void *tjost_realloc(Tjost_Host *host, size_t len, void *buf);
 void tjost_free(Tjost_Host *host, void *buf);
 
+// in tjost.c
+Tjost_Event *tjost_event_ref(Tjost_Event *tev);
+void tjost_event_unref(Tjost_Host *host, Tjost_Event *tev);
+
 void tjost_host_schedule(Tjost_Host *host, Tjost_Module *module, jack_nframes_t time, size_t len, void *buf);
 osc_data_t *tjost_host_schedule_inline(Tjost_Host *host, Tjost_Module *module, jack_nframes_t time, size_t len);
 void tjost_module_schedule(Tjost_Module *module, jack_nframes_t time, size_t len, void *buf);
+void tjost_quota_release(Tjost_Module *module, size_t len);
 
 void tjost_host_message_push(Tjost_Host *host, const char *fmt, ...);
-int tjost_host_message_pull(Tjost_Host *host, char *str);
+int tjost_host_message_pull(Tjost_Host *host, char *str, size_t size);
+
+// in tjost_wakeup.c, wakeups are queued and flushed by the real time thread only
+void tjost_wakeup_init(Tjost_Wakeup *wake, uv_async_t *async, jack_ringbuffer_t *rb);
+void tjost_host_wakeup(Tjost_Host *host, Tjost_Wakeup *wake, Tjost_Module *module);
+void tjost_host_wakeup_cancel(Tjost_Wakeup *wake);
+void tjost_host_wakeup_flush(Tjost_Host *host, jack_nframes_t now);
+
+// in tjost_queue.c
+void tjost_queue_init(Tjost_Queue *queue, jack_nframes_t period);
+void tjost_queue_insert(Tjost_Queue *queue, Tjost_Event *tev);
+Tjost_Event *tjost_queue_pop(Tjost_Queue *queue, jack_nframes_t horizon);
+void tjost_queue_clear(Tjost_Queue *queue, Tjost_Host *host);
+Tjost_Event *tjost_module_queue_alloc(Tjost_Module *module, size_t len);
+void tjost_module_queue_push(Tjost_Module *module, Tjost_Event *tev);
+Tjost_Event *tjost_module_drain(Tjost_Module *module, jack_nframes_t last, jack_nframes_t nframes, jack_nframes_t *time);
+unsigned int tjost_module_queue_count(Tjost_Module *module);
+void tjost_module_queue_clear(Tjost_Module *module);
+void tjost_module_queue_deinit(Tjost_Module *module);
+
+// in tjost_routing.c
+void tjost_routing_compile(Tjost_Host *host);
+void tjost_routing_deinit(Tjost_Host *host);
+
+// in tjost_slab.c
+void tjost_slab_init(Tjost_Slab *slab);
+void tjost_slab_deinit(Tjost_Host *host);
+Tjost_Event *tjost_event_alloc(Tjost_Host *host, size_t len);
+void tjost_event_free(Tjost_Host *host, Tjost_Event *tev);
+
+// in tjost_log.c
+void tjost_log_init(Tjost_Log *log);
+int tjost_log_vpush(Tjost_Log *log, const char *fmt, va_list argv);
+int tjost_log_pull(Tjost_Log *log, char *str, size_t size);
+void tjost_log_summary(Tjost_Log *log);
+
+// in tjost_router.c
+Tjost_Router *tjost_router_new(Tjost_Host *host, unsigned int count, size_t len);
+int tjost_router_add(Tjost_Router *router, const char *path, Tjost_Module *target);
+Tjost_Module *tjost_router_lookup(Tjost_Router *router, const char *path);
+void tjost_router_free(Tjost_Host *host, Tjost_Router *router);
 
 // in tjost_pipe.c
-int tjost_pipe_init(Tjost_Pipe *pipe);
+int tjost_pipe_init(Tjost_Pipe *pipe, Tjost_Module *module);
+int tjost_pipe_init_mpsc(Tjost_Pipe *pipe, Tjost_Module *module);
 int tjost_pipe_deinit(Tjost_Pipe *pipe);
+size_t tjost_pipe_fill(Tjost_Pipe *pipe);
 size_t tjost_pipe_space(Tjost_Pipe *pipe);
+osc_data_t *tjost_pipe_reserve(Tjost_Pipe *pipe, size_t len);
+int tjost_pipe_commit(Tjost_Pipe *pipe, Tjost_Module *module, jack_nframes_t timestamp, size_t len);
 int tjost_pipe_produce(Tjost_Pipe *pipe, Tjost_Module *module, jack_nframes_t timestamp, size_t len, osc_data_t *buf);
-int tjost_pipe_flush(Tjost_Pipe *pipe);
+void tjost_pipe_flush(Tjost_Pipe *pipe, Tjost_Module *module);
+void tjost_pipe_forget(Tjost_Pipe *pipe, Tjost_Module *module);
+Tjost_Pipe_Record *tjost_pipe_peek(Tjost_Pipe *pipe);
+void tjost_pipe_release(Tjost_Pipe *pipe, Tjost_Pipe_Record *rec);
 int tjost_pipe_consume(Tjost_Pipe *pipe, Tjost_Pipe_Alloc_Cb alloc_cb, Tjost_Pipe_Sched_Cb sched_cb, void *arg);
 int tjost_pipe_listen_start(Tjost_Pipe *pipe, uv_loop_t *loop, Tjost_Pipe_Alloc_Cb alloc_cb, Tjost_Pipe_Sched_Cb sched_cb, void *arg);
 int tjost_pipe_listen_stop(Tjost_Pipe *pipe);
 
 // in tjost_lua.c
-void tjost_lua_deserialize(Tjost_Event *tev);
+void tjost_lua_deserialize(Tjost_Module *module, Tjost_Event *tev, jack_nframes_t time);
+void tjost_lua_flush(Tjost_Module *module);
 extern const luaL_Reg tjost_input_mt [];
 extern const luaL_Reg tjost_output_mt [];
 extern const luaL_Reg tjost_in_out_mt [];
@@ -223,14 +673,14 @@ extern const luaL_Reg tjost_uplink_mt [];
 extern const luaL_Reg tjost_globals [];
 extern const luaL_Reg tjost_blob_mt [];
 extern const luaL_Reg tjost_midi_mt [];
+extern const luaL_Reg tjost_batch_mt [];
 void tjost_lua_init(Tjost_Host *host, int argc, const char **argv);
 void tjost_lua_deinit(Tjost_Host *host);
 void tjost_lua_deregister(Tjost_Host *host);
 
 // in tjost_uplink.c
-osc_data_t * tjost_uplink_tx_drain_alloc(Tjost_Event *tev, void *arg);
 int tjost_uplink_tx_drain_sched(Tjost_Event *tev, osc_data_t *buf, void *arg);
-void tjost_uplink_tx_push(Tjost_Host *host, Tjost_Event *tev);
+void tjost_uplink_tx_push(Tjost_Host *host, Tjost_Module *module, jack_nframes_t time, Tjost_Event *tev);
 void tjost_uplink_rx_drain(Tjost_Host *host, int ignore);
 
 void tjost_client_registration(const char *name, int state, void *arg);
@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2015 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <tjost.h>
+
+static const char *heap_names [TJOST_HEAP_MAX] = {
+	[TJOST_HEAP_STATIC] = "static",
+	[TJOST_HEAP_EVENT] = "event",
+	[TJOST_HEAP_LUA] = "lua"
+};
+
+static Tjost_Mem_Chunk *
+_tjost_heap_map(Tjost_Heap *heap, size_t size)
+{
+	// prefault pages now instead of on first touch in the real time thread
+	int flags = MAP_PRIVATE|MAP_ANONYMOUS|MAP_LOCKED|MAP_POPULATE;
+	if(heap->lowmem)
+		flags |= MAP_32BIT;
+	void *area = MAP_FAILED;
+
+	if(heap->hugetlb)
+	{
+		// huge pages reduce TLB misses, fall back to normal pages if none are available
+		if((area = mmap(NULL, size, PROT_READ|PROT_WRITE, flags|MAP_HUGETLB, -1, 0)) == MAP_FAILED)
+			fprintf(stderr, "_tjost_heap_map: no huge pages for %s heap, using normal pages\n", heap->name);
+	}
+
+	if(area == MAP_FAILED)
+		area = mmap(NULL, size, PROT_READ|PROT_WRITE, flags, -1, 0);
+
+	if(area == MAP_FAILED)
+		return NULL;
+
+	Tjost_Mem_Chunk *chunk = calloc(1, sizeof(Tjost_Mem_Chunk));
+	if(!chunk)
+	{
+		munmap(area, size);
+		return NULL;
+	}
+
+	chunk->heap = heap;
+	chunk->size = size;
+	chunk->area = area;
+
+	return chunk;
+}
+
+static void
+_tjost_heap_unmap(Tjost_Mem_Chunk *chunk)
+{
+	munmap(chunk->area, chunk->size);
+	free(chunk);
+}
+
+// request a new chunk from the main loop once usage crosses the high watermark
+static inline void
+_tjost_heap_account(Tjost_Host *host, Tjost_Heap *heap, size_t used)
+{
+	size_t peak = __atomic_load_n(&heap->peak, __ATOMIC_RELAXED);
+	while( (used > peak)
+		&& !__atomic_compare_exchange_n(&heap->peak, &peak, used, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+		;
+
+	if( (used > heap->sum * heap->high)
+		&& (heap->nchunks < TJOST_HEAP_CHUNKS)
+		&& (!heap->max || (heap->sum + heap->step <= heap->max))
+		&& (__atomic_load_n(&heap->flag, __ATOMIC_ACQUIRE) == TJOST_HEAP_IDLE) )
+	{
+		__atomic_store_n(&heap->flag, TJOST_HEAP_REQUESTED, __ATOMIC_RELEASE);
+		uv_async_send(&host->rtmem);
+	}
+}
+
+// chunk holding given block, binary search bounded by TJOST_HEAP_CHUNKS
+static inline Tjost_Mem_Chunk *
+_tjost_heap_chunk(Tjost_Heap *heap, void *ptr)
+{
+	unsigned int lo = 0;
+	unsigned int hi = heap->nchunks;
+
+	while(lo < hi)
+	{
+		unsigned int mid = (lo + hi) / 2;
+		Tjost_Mem_Chunk *chunk = heap->ranges[mid];
+
+		if((uint8_t *)ptr < (uint8_t *)chunk->area)
+			hi = mid;
+		else if((uint8_t *)ptr >= (uint8_t *)chunk->area + chunk->size)
+			lo = mid + 1;
+		else
+			return chunk;
+	}
+
+	return NULL;
+}
+
+// add chunk to list and address table, caller checks for space
+static void
+_tjost_heap_attach(Tjost_Heap *heap, Tjost_Mem_Chunk *chunk)
+{
+	unsigned int i;
+
+	for(i=heap->nchunks; (i > 0) && ((uint8_t *)heap->ranges[i-1]->area > (uint8_t *)chunk->area); i--)
+		heap->ranges[i] = heap->ranges[i-1];
+	heap->ranges[i] = chunk;
+	heap->nchunks++;
+
+	heap->chunks = eina_inlist_prepend(heap->chunks, EINA_INLIST_GET(chunk));
+	heap->sum += chunk->size;
+}
+
+static void
+_tjost_heap_detach(Tjost_Heap *heap, Tjost_Mem_Chunk *chunk)
+{
+	unsigned int i;
+
+	for(i=0; (i < heap->nchunks) && (heap->ranges[i] != chunk); i++)
+		;
+	for(heap->nchunks--; i < heap->nchunks; i++)
+		heap->ranges[i] = heap->ranges[i+1];
+
+	heap->chunks = eina_inlist_remove(heap->chunks, EINA_INLIST_GET(chunk));
+	heap->sum -= chunk->size;
+}
+
+// real time, detach newest chunk if it is completely free and usage is below the low watermark
+static void
+_tjost_heap_shrink(Tjost_Host *host, Tjost_Heap *heap)
+{
+	if(!heap->chunks || (heap->used >= heap->sum * heap->low))
+		return;
+
+	Tjost_Mem_Chunk *chunk = EINA_INLIST_CONTAINER_GET(heap->chunks, Tjost_Mem_Chunk);
+	size_t sum = heap->sum - chunk->size;
+
+	// never release the initial chunk, nor go below reservation or back above the high watermark
+	if(chunk->fixed || (sum < heap->reserve) || (heap->used > sum * heap->high))
+		return;
+
+	if(jack_ringbuffer_write_space(host->rb_rtmem_release) < sizeof(uintptr_t))
+		return;
+
+	// still holds allocated blocks?
+	if(__atomic_load_n(&chunk->live, __ATOMIC_RELAXED))
+		return;
+
+	tlsf_remove_pool(heap->tlsf, chunk->pool);
+	_tjost_heap_detach(heap, chunk);
+
+	// unmap on main loop
+	jack_ringbuffer_write(host->rb_rtmem_release, (const char *)&chunk, sizeof(uintptr_t));
+	uv_async_send(&host->rtmem);
+
+	tjost_host_message_push(host, "Rt memory of %s heap shrunk to: 0x%zx bytes", heap->name, heap->sum);
+}
+
+int
+tjost_heap_init(Tjost_Host *host, Tjost_Heap_Id id, size_t size)
+{
+	Tjost_Heap *heap = &host->heaps[id];
+	Tjost_Mem_Chunk *chunk;
+
+	memset(heap, 0, sizeof(Tjost_Heap));
+	heap->name = heap_names[id];
+	heap->step = size;
+	heap->high = TJOST_HEAP_HIGH;
+	heap->low = TJOST_HEAP_LOW;
+#ifndef HAS_LUA_GC64
+	// LuaJIT without GC64 only handles objects in the lower 2GB, other heaps never hold Lua objects
+	heap->lowmem = id == TJOST_HEAP_LUA;
+#endif
+
+	if(!(chunk = _tjost_heap_map(heap, size)))
+		return -1;
+
+	if(!(heap->tlsf = tlsf_create_with_pool(chunk->area, chunk->size)))
+	{
+		_tjost_heap_unmap(chunk);
+		return -1;
+	}
+
+	chunk->pool = tlsf_get_pool(heap->tlsf);
+	chunk->fixed = 1; // holds TLSF control structure
+	_tjost_heap_attach(heap, chunk);
+
+	return 0;
+}
+
+Tjost_Heap *
+tjost_heap_find(Tjost_Host *host, const char *name)
+{
+	int i;
+
+	for(i=0; i<TJOST_HEAP_MAX; i++)
+		if(!strcmp(host->heaps[i].name, name))
+			return &host->heaps[i];
+
+	return NULL;
+}
+
+// largest chunk TLSF accepts as a single pool, in whole growth steps if possible
+static size_t
+_tjost_heap_chunk_max(Tjost_Heap *heap)
+{
+	size_t max = tlsf_block_size_max();
+	size_t align = heap->hugetlb ? TJOST_HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+
+	if(heap->step <= max)
+		return max / heap->step * heap->step;
+
+	return max / align * align;
+}
+
+// non real time, before activation only, grow heap to at least given size
+int
+tjost_heap_reserve(Tjost_Host *host, Tjost_Heap *heap, size_t size)
+{
+	size_t chunk_max = _tjost_heap_chunk_max(heap);
+
+	heap->reserve = size;
+
+	while(heap->sum < size)
+	{
+		Tjost_Mem_Chunk *chunk;
+
+		// map the missing part in whole growth steps, as few chunks as TLSF allows
+		size_t missing = (size - heap->sum + heap->step - 1) / heap->step * heap->step;
+		if(missing > chunk_max)
+			missing = chunk_max;
+
+		if( (heap->nchunks >= TJOST_HEAP_CHUNKS) || (heap->max && (heap->sum + missing > heap->max)) )
+			return -1;
+
+		if(!(chunk = _tjost_heap_map(heap, missing)))
+			return -1;
+
+		// pages of a reservation must stay resident, warn if they cannot be locked
+		if(mlock(chunk->area, chunk->size))
+			fprintf(stderr, "tjost_heap_reserve: could not lock %s heap, check RLIMIT_MEMLOCK\n", heap->name);
+
+		if(!(chunk->pool = tlsf_add_pool(heap->tlsf, chunk->area, chunk->size)))
+		{
+			_tjost_heap_unmap(chunk);
+			return -1;
+		}
+		_tjost_heap_attach(heap, chunk);
+	}
+
+	return 0;
+}
+
+void
+tjost_heap_deinit(Tjost_Host *host, Tjost_Heap_Id id)
+{
+	Tjost_Heap *heap = &host->heaps[id];
+	Eina_Inlist *l;
+	Tjost_Mem_Chunk *chunk;
+
+	if(!heap->tlsf)
+		return;
+
+	EINA_INLIST_FOREACH(heap->chunks, chunk)
+		if(!chunk->fixed)
+			tlsf_remove_pool(heap->tlsf, chunk->pool);
+
+	tlsf_destroy(heap->tlsf);
+	heap->tlsf = NULL;
+
+	// unmap all chunks, including the one with the TLSF control structure
+	EINA_INLIST_FOREACH_SAFE(heap->chunks, l, chunk)
+	{
+		_tjost_heap_detach(heap, chunk);
+		_tjost_heap_unmap(chunk);
+	}
+}
+
+// non real time
+void
+tjost_heap_request(uv_async_t *handle)
+{
+	Tjost_Host *host = handle->data;
+	int i;
+
+	// unmap chunks released by real time thread
+	while(jack_ringbuffer_read_space(host->rb_rtmem_release) >= sizeof(uintptr_t))
+	{
+		Tjost_Mem_Chunk *chunk;
+
+		jack_ringbuffer_read(host->rb_rtmem_release, (char *)&chunk, sizeof(uintptr_t));
+		_tjost_heap_unmap(chunk);
+	}
+
+	for(i=0; i<TJOST_HEAP_MAX; i++)
+	{
+		Tjost_Heap *heap = &host->heaps[i];
+		Tjost_Mem_Chunk *chunk;
+
+		if(__atomic_load_n(&heap->flag, __ATOMIC_ACQUIRE) != TJOST_HEAP_REQUESTED)
+			continue;
+
+		if(!(chunk = _tjost_heap_map(heap, heap->step)))
+			fprintf(stderr, "tjost_heap_request: could not allocate RT memory chunk for %s heap\n", heap->name);
+		else if(jack_ringbuffer_write_space(host->rb_rtmem) < sizeof(uintptr_t))
+		{
+			fprintf(stderr, "tjost_heap_request: ring buffer overflow\n");
+			_tjost_heap_unmap(chunk);
+		}
+		else
+		{
+			__atomic_store_n(&heap->flag, TJOST_HEAP_PENDING, __ATOMIC_RELEASE);
+			jack_ringbuffer_write(host->rb_rtmem, (const char *)&chunk, sizeof(uintptr_t));
+		}
+	}
+}
+
+// real time, called once per period
+void
+tjost_heap_add(Tjost_Host *host)
+{
+	while(jack_ringbuffer_read_space(host->rb_rtmem) >= sizeof(uintptr_t))
+	{
+		Tjost_Mem_Chunk *chunk;
+
+		jack_ringbuffer_read(host->rb_rtmem, (char *)&chunk, sizeof(uintptr_t));
+
+		Tjost_Heap *heap = chunk->heap;
+		chunk->pool = tlsf_add_pool(heap->tlsf, chunk->area, chunk->size);
+		_tjost_heap_attach(heap, chunk);
+		__atomic_store_n(&heap->flag, TJOST_HEAP_IDLE, __ATOMIC_RELEASE);
+
+		tjost_host_message_push(host, "Rt memory of %s heap extended to: 0x%zx bytes", heap->name, heap->sum);
+	}
+
+	// look for releasable chunks now and then
+	if(++host->rtmem_tick >= TJOST_HEAP_SHRINK_PERIODS)
+	{
+		int i;
+
+		host->rtmem_tick = 0;
+		for(i=0; i<TJOST_HEAP_MAX; i++)
+			_tjost_heap_shrink(host, &host->heaps[i]);
+	}
+}
+
+void *
+tjost_heap_alloc(Tjost_Host *host, Tjost_Heap_Id id, size_t len)
+{
+	Tjost_Heap *heap = &host->heaps[id];
+	void *data;
+
+	if(!(data = tlsf_malloc(heap->tlsf, len)))
+	{
+		__atomic_add_fetch(&heap->failed, 1, __ATOMIC_RELAXED);
+		tjost_host_message_push(host, "tjost_alloc: %s heap out of memory", heap->name);
+		return NULL;
+	}
+
+	size_t size = tlsf_block_size(data);
+	Tjost_Mem_Chunk *chunk = _tjost_heap_chunk(heap, data);
+	if(chunk)
+		__atomic_add_fetch(&chunk->live, size, __ATOMIC_RELAXED);
+
+	__atomic_add_fetch(&heap->blocks, 1, __ATOMIC_RELAXED);
+	size_t used = __atomic_add_fetch(&heap->used, size, __ATOMIC_RELAXED);
+	_tjost_heap_account(host, heap, used);
+
+	return data;
+}
+
+void *
+tjost_heap_realloc(Tjost_Host *host, Tjost_Heap_Id id, size_t len, void *buf)
+{
+	Tjost_Heap *heap = &host->heaps[id];
+	size_t size = tlsf_block_size(buf);
+	Tjost_Mem_Chunk *chunk = buf ? _tjost_heap_chunk(heap, buf) : NULL;
+	void *data;
+
+	if(!(data = tlsf_realloc(heap->tlsf, buf, len)))
+	{
+		__atomic_add_fetch(&heap->failed, 1, __ATOMIC_RELAXED);
+		tjost_host_message_push(host, "tjost_realloc: %s heap out of memory", heap->name);
+		return NULL; // buf is still valid
+	}
+
+	// block may have moved to another chunk
+	if(chunk)
+		__atomic_sub_fetch(&chunk->live, size, __ATOMIC_RELAXED);
+	else
+		__atomic_add_fetch(&heap->blocks, 1, __ATOMIC_RELAXED);
+	if((chunk = _tjost_heap_chunk(heap, data)))
+		__atomic_add_fetch(&chunk->live, tlsf_block_size(data), __ATOMIC_RELAXED);
+
+	size_t used = __atomic_add_fetch(&heap->used, tlsf_block_size(data) - size, __ATOMIC_RELAXED);
+	_tjost_heap_account(host, heap, used);
+
+	return data;
+}
+
+void
+tjost_heap_free(Tjost_Host *host, Tjost_Heap_Id id, void *buf)
+{
+	Tjost_Heap *heap = &host->heaps[id];
+
+	if(!buf)
+		return;
+
+	size_t size = tlsf_block_size(buf);
+	Tjost_Mem_Chunk *chunk = _tjost_heap_chunk(heap, buf);
+	if(chunk)
+		__atomic_sub_fetch(&chunk->live, size, __ATOMIC_RELAXED);
+
+	__atomic_sub_fetch(&heap->blocks, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&heap->used, size, __ATOMIC_RELAXED);
+	tlsf_free(heap->tlsf, buf);
+}
+
+// real time thread only, as it owns the TLSF pools, constant time
+void
+tjost_heap_stats(Tjost_Heap *heap, Tjost_Heap_Stats *stats)
+{
+	size_t overhead = heap->nchunks * tlsf_pool_overhead() + tlsf_size();
+
+	stats->used = __atomic_load_n(&heap->used, __ATOMIC_RELAXED);
+	stats->nused = __atomic_load_n(&heap->blocks, __ATOMIC_RELAXED);
+	overhead += stats->nused * tlsf_alloc_overhead();
+	stats->free = heap->sum > stats->used + overhead ? heap->sum - stats->used - overhead : 0;
+	stats->largest = tlsf_free_max(heap->tlsf);
+
+	// share of free memory not usable for the largest possible allocation
+	stats->fragmentation = stats->free > stats->largest ? 1.f - (float)stats->largest / stats->free : 0.f;
+}
+
+// real time, broadcast stats of one heap per interval to all uplinks
+void
+tjost_heap_report(Tjost_Host *host, jack_nframes_t nframes)
+{
+	if(!host->heap_report)
+		return;
+
+	host->heap_report_frames += nframes;
+	if(host->heap_report_frames < host->heap_report)
+		return;
+	host->heap_report_frames = 0;
+
+	Tjost_Heap *heap = &host->heaps[host->heap_report_next];
+	host->heap_report_next = (host->heap_report_next + 1) % TJOST_HEAP_MAX;
+
+	Tjost_Heap_Stats stats;
+	tjost_heap_stats(heap, &stats);
+
+	osc_data_t buf [128];
+	osc_data_t *ptr = osc_set_vararg(buf, buf + 128, "/tjost/heap", "shhhhif",
+		heap->name, (int64_t)heap->sum, (int64_t)stats.used, (int64_t)stats.free, (int64_t)stats.largest,
+		(int32_t)stats.nused, stats.fragmentation);
+	if(ptr)
+		tjost_host_schedule(host, TJOST_MODULE_BROADCAST, 0, ptr - buf, buf);
+}
+
+void *
+tjost_alloc(Tjost_Host *host, size_t len)
+{
+	return tjost_heap_alloc(host, TJOST_HEAP_STATIC, len);
+}
+
+void *
+tjost_realloc(Tjost_Host *host, size_t len, void *buf)
+{
+	return tjost_heap_realloc(host, TJOST_HEAP_STATIC, len, buf);
+}
+
+void
+tjost_free(Tjost_Host *host, void *buf)
+{
+	tjost_heap_free(host, TJOST_HEAP_STATIC, buf);
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2015 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <tjost.h>
+
+#define TJOST_LOG_MASK (TJOST_LOG_SLOTS - 1)
+#define TJOST_LOG_IDS_MASK (TJOST_LOG_IDS - 1)
+
+typedef enum _Tjost_Log_Type {
+	TJOST_LOG_NONE,
+	TJOST_LOG_INT,
+	TJOST_LOG_LONG,
+	TJOST_LOG_LONG_LONG,
+	TJOST_LOG_SIZE,
+	TJOST_LOG_DOUBLE,
+	TJOST_LOG_STRING,
+	TJOST_LOG_POINTER
+} Tjost_Log_Type;
+
+// parse one conversion specification starting after '%', returns pointer to its conversion character
+static const char *
+_tjost_log_spec(const char *fmt, Tjost_Log_Type *type)
+{
+	const char *c = fmt;
+	int longs = 0;
+	int size = 0;
+
+	while(strchr("-+ #0123456789.", *c) && *c)
+		c++;
+
+	for( ; strchr("hlzjt", *c) && *c; c++)
+	{
+		if(*c == 'l')
+			longs++;
+		else if(*c != 'h')
+			size = 1;
+	}
+
+	switch(*c)
+	{
+		case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+			*type = size ? TJOST_LOG_SIZE
+				: longs > 1 ? TJOST_LOG_LONG_LONG
+				: longs == 1 ? TJOST_LOG_LONG
+				: TJOST_LOG_INT;
+			break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+			*type = TJOST_LOG_DOUBLE;
+			break;
+		case 's':
+			*type = TJOST_LOG_STRING;
+			break;
+		case 'p':
+			*type = TJOST_LOG_POINTER;
+			break;
+		default: // '%%' and unknown conversions
+			*type = TJOST_LOG_NONE;
+			break;
+	}
+
+	return c;
+}
+
+// find or claim counters for a message id
+static Tjost_Log_Id *
+_tjost_log_id(Tjost_Log *log, const char *fmt)
+{
+	unsigned int idx = ((uintptr_t)fmt >> 3) & TJOST_LOG_IDS_MASK;
+	unsigned int i;
+
+	for(i=0; i<TJOST_LOG_IDS; i++, idx=(idx+1) & TJOST_LOG_IDS_MASK)
+	{
+		Tjost_Log_Id *id = &log->ids[idx];
+		const char *cur = __atomic_load_n(&id->fmt, __ATOMIC_ACQUIRE);
+
+		if(cur == fmt)
+			return id;
+
+		if(!cur)
+		{
+			const char *empty = NULL;
+			if(__atomic_compare_exchange_n(&id->fmt, &empty, fmt, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+					|| (empty == fmt))
+				return id;
+		}
+	}
+
+	return NULL; // table full, no rate limiting for this id
+}
+
+void
+tjost_log_init(Tjost_Log *log)
+{
+	unsigned int i;
+
+	memset(log, 0, sizeof(Tjost_Log));
+	for(i=0; i<TJOST_LOG_SLOTS; i++)
+		log->slots[i].seq = i;
+}
+
+// lock-free, allocation-free, safe to call from any thread
+int
+tjost_log_vpush(Tjost_Log *log, const char *fmt, va_list argv)
+{
+	Tjost_Log_Id *id = _tjost_log_id(log, fmt);
+	unsigned int suppressed = 0;
+
+	if(id)
+	{
+		uint64_t window = uv_hrtime() / 1000000000ULL; // one second windows
+
+		__atomic_add_fetch(&id->total, 1, __ATOMIC_RELAXED);
+
+		if(__atomic_load_n(&id->window, __ATOMIC_RELAXED) != window)
+		{
+			__atomic_store_n(&id->window, window, __ATOMIC_RELAXED);
+			__atomic_store_n(&id->count, 0, __ATOMIC_RELAXED);
+		}
+
+		if(__atomic_fetch_add(&id->count, 1, __ATOMIC_RELAXED) >= TJOST_LOG_RATE)
+		{
+			__atomic_add_fetch(&id->suppressed, 1, __ATOMIC_RELAXED);
+			return 0;
+		}
+
+		suppressed = __atomic_exchange_n(&id->suppressed, 0, __ATOMIC_RELAXED);
+	}
+
+	// claim a slot
+	unsigned int pos = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+	Tjost_Log_Record *rec;
+
+	while(1)
+	{
+		rec = &log->slots[pos & TJOST_LOG_MASK];
+		int diff = (int)(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) - pos);
+
+		if(diff == 0)
+		{
+			if(__atomic_compare_exchange_n(&log->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(diff < 0) // ring full
+		{
+			__atomic_add_fetch(&log->lost, 1 + suppressed, __ATOMIC_RELAXED);
+			return -1;
+		}
+		else
+			pos = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+	}
+
+	// record raw arguments, strings are copied as they may not outlive the call
+	rec->fmt = fmt;
+	rec->suppressed = suppressed;
+	rec->argc = 0;
+
+	char *str = rec->str;
+	char *end = rec->str + TJOST_LOG_STR_SIZE;
+	const char *c;
+
+	for(c=fmt; *c; c++)
+	{
+		if(*c != '%')
+			continue;
+
+		Tjost_Log_Type type;
+		c = _tjost_log_spec(c + 1, &type);
+
+		if(type == TJOST_LOG_NONE)
+		{
+			if(!*c)
+				break;
+			continue;
+		}
+
+		if(rec->argc >= TJOST_LOG_ARGS)
+			break;
+
+		Tjost_Log_Arg *arg = &rec->argv[rec->argc++];
+		switch(type)
+		{
+			case TJOST_LOG_INT:
+				arg->h = va_arg(argv, int);
+				break;
+			case TJOST_LOG_LONG:
+				arg->h = va_arg(argv, long);
+				break;
+			case TJOST_LOG_LONG_LONG:
+				arg->h = va_arg(argv, long long);
+				break;
+			case TJOST_LOG_SIZE:
+				arg->h = va_arg(argv, size_t);
+				break;
+			case TJOST_LOG_DOUBLE:
+				arg->d = va_arg(argv, double);
+				break;
+			case TJOST_LOG_POINTER:
+				arg->p = va_arg(argv, void *);
+				break;
+			case TJOST_LOG_STRING:
+			{
+				const char *s = va_arg(argv, const char *);
+
+				if(str == end) // storage exhausted, last byte is a terminating zero
+				{
+					arg->s = TJOST_LOG_STR_SIZE - 1;
+					break;
+				}
+				arg->s = str - rec->str;
+
+				if(!s)
+					s = "(null)";
+				while(*s && (str < end - 1))
+					*str++ = *s++;
+				if(str < end)
+					*str++ = '\0';
+				break;
+			}
+			case TJOST_LOG_NONE:
+				break;
+		}
+	}
+
+	// hand over to consumer
+	__atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+// single consumer, formats the next record into str
+int
+tjost_log_pull(Tjost_Log *log, char *str, size_t size)
+{
+	unsigned int pos = log->head;
+	Tjost_Log_Record *rec = &log->slots[pos & TJOST_LOG_MASK];
+
+	if(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != pos + 1)
+	{
+		unsigned int lost = __atomic_exchange_n(&log->lost, 0, __ATOMIC_RELAXED);
+		if(lost)
+		{
+			snprintf(str, size, "log: %u messages lost", lost);
+			return 1;
+		}
+
+		// report suppressed messages of ids that went quiet
+		uint64_t window = uv_hrtime() / 1000000000ULL;
+		unsigned int i;
+		for(i=0; i<TJOST_LOG_IDS; i++)
+		{
+			Tjost_Log_Id *id = &log->ids[i];
+			const char *fmt = __atomic_load_n(&id->fmt, __ATOMIC_ACQUIRE);
+
+			if(!fmt || (__atomic_load_n(&id->window, __ATOMIC_RELAXED) == window))
+				continue;
+
+			unsigned int suppressed = __atomic_exchange_n(&id->suppressed, 0, __ATOMIC_RELAXED);
+			if(suppressed)
+			{
+				snprintf(str, size, "log: %u messages suppressed like '%s'", suppressed, fmt);
+				return 1;
+			}
+		}
+
+		return 0;
+	}
+
+	char *ptr = str;
+	char *end = str + size;
+	const char *c;
+	int argi = 0;
+
+	for(c=rec->fmt; *c && (ptr < end - 1); c++)
+	{
+		if(*c != '%')
+		{
+			*ptr++ = *c;
+			continue;
+		}
+
+		Tjost_Log_Type type;
+		const char *conv = _tjost_log_spec(c + 1, &type);
+
+		if(!*conv)
+			break;
+
+		char spec [32];
+		size_t len = conv - c + 1;
+		if(len >= sizeof(spec))
+			len = sizeof(spec) - 1;
+		strncpy(spec, c, len);
+		spec[len] = '\0';
+		c = conv;
+
+		if( (type != TJOST_LOG_NONE) && (argi >= rec->argc) )
+			break;
+
+		Tjost_Log_Arg *arg = &rec->argv[argi];
+		int n = 0;
+		switch(type)
+		{
+			case TJOST_LOG_NONE:
+				n = snprintf(ptr, end - ptr, "%s", *conv == '%' ? "%" : spec);
+				break;
+			case TJOST_LOG_INT:
+				n = snprintf(ptr, end - ptr, spec, (int)arg->h);
+				break;
+			case TJOST_LOG_LONG:
+				n = snprintf(ptr, end - ptr, spec, (long)arg->h);
+				break;
+			case TJOST_LOG_LONG_LONG:
+				n = snprintf(ptr, end - ptr, spec, (long long)arg->h);
+				break;
+			case TJOST_LOG_SIZE:
+				n = snprintf(ptr, end - ptr, spec, (size_t)arg->h);
+				break;
+			case TJOST_LOG_DOUBLE:
+				n = snprintf(ptr, end - ptr, spec, arg->d);
+				break;
+			case TJOST_LOG_POINTER:
+				n = snprintf(ptr, end - ptr, spec, arg->p);
+				break;
+			case TJOST_LOG_STRING:
+				n = snprintf(ptr, end - ptr, spec, rec->str + arg->s);
+				break;
+		}
+		if(type != TJOST_LOG_NONE)
+			argi++;
+
+		if(n > 0)
+			ptr = (n < end - ptr) ? ptr + n : end - 1;
+	}
+
+	if(rec->suppressed && (ptr < end - 1))
+	{
+		int n = snprintf(ptr, end - ptr, " (%u similar messages suppressed)", rec->suppressed);
+		if(n > 0)
+			ptr = (n < end - ptr) ? ptr + n : end - 1;
+	}
+	*ptr = '\0';
+
+	// release slot to producers
+	__atomic_store_n(&rec->seq, pos + TJOST_LOG_SLOTS, __ATOMIC_RELEASE);
+	log->head = pos + 1;
+
+	return 1;
+}
+
+// per message id totals, for shutdown
+void
+tjost_log_summary(Tjost_Log *log)
+{
+	unsigned int i;
+
+	for(i=0; i<TJOST_LOG_IDS; i++)
+	{
+		Tjost_Log_Id *id = &log->ids[i];
+
+		if(id->fmt && (id->total > TJOST_LOG_RATE))
+			fprintf(stderr, "MESSAGE: %u times '%s'\n", id->total, id->fmt);
+	}
+}
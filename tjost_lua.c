@@ -24,11 +24,79 @@
 #define TJOST_BUNDLE_POP_PATH		"/bundle/pop"
 #define TJOST_BUNDLE_POP_FMT 		""
 
-static osc_data_t *
-_push(Tjost_Host *host, osc_type_t type, osc_data_t *ptr)
+// push a view from the pool, new views are only created when the pool grows
+static Tjost_View *
+_view_push(lua_State *L, Tjost_Host *host)
 {
-	lua_State *L = host->L;
+	Tjost_Views *views = &host->views;
+	Tjost_View *tv;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, views->ref);
+	lua_rawgeti(L, -1, ++views->used);
+	if(!(tv = lua_touserdata(L, -1)))
+	{
+		lua_pop(L, 1); // nil
+
+		tv = lua_newuserdata(L, sizeof(Tjost_View));
+		luaL_getmetatable(L, "Tjost_View");
+		lua_setmetatable(L, -2);
+
+		lua_pushvalue(L, -1);
+		lua_rawseti(L, -3, views->used);
+	}
+	lua_remove(L, -2); // pool
+
+	return tv;
+}
+
+// expire all views handed out since last release
+static void
+_view_release(lua_State *L, Tjost_Host *host)
+{
+	Tjost_Views *views = &host->views;
 
+	if(!views->used)
+		return;
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, views->ref);
+	for( ; views->used > 0; views->used--)
+	{
+		lua_rawgeti(L, -1, views->used);
+		Tjost_View *tv = lua_touserdata(L, -1);
+		tv->size = 0;
+		tv->buf = NULL;
+		lua_pop(L, 1);
+	}
+	lua_pop(L, 1); // pool
+}
+
+static inline Tjost_View *
+_check_view(lua_State *L, int idx)
+{
+	Tjost_View *tv = luaL_checkudata(L, idx, "Tjost_View");
+	if(!tv->buf)
+		luaL_error(L, "view expired, use :copy() to keep it beyond the callback");
+	return tv;
+}
+
+static inline int
+_is_view(lua_State *L, int idx)
+{
+	int is_view = 0;
+
+	if(lua_getmetatable(L, idx))
+	{
+		luaL_getmetatable(L, "Tjost_View");
+		is_view = lua_rawequal(L, -1, -2);
+		lua_pop(L, 2);
+	}
+
+	return is_view;
+}
+
+static osc_data_t *
+_push(lua_State *L, Tjost_Host *host, osc_type_t type, osc_data_t *ptr, int borrow)
+{
 	switch(type)
 	{
 		case OSC_INT32:
@@ -57,6 +125,15 @@ _push(Tjost_Host *host, osc_type_t type, osc_data_t *ptr)
 			osc_blob_t b;
 			ptr = osc_get_blob(ptr, &b);
 
+			if(borrow)
+			{
+				Tjost_View *tv = _view_push(L, host);
+				tv->size = b.size;
+				tv->buf = b.payload;
+				tv->midi = 0;
+				return ptr;
+			}
+
 			Tjost_Blob *tb = lua_newuserdata(L, sizeof(Tjost_Blob) + b.size);
 			luaL_getmetatable(L, "Tjost_Blob");
 			lua_setmetatable(L, -2);
@@ -120,6 +197,15 @@ _push(Tjost_Host *host, osc_type_t type, osc_data_t *ptr)
 			uint8_t *m;
 			ptr = osc_get_midi(ptr, &m);
 
+			if(borrow)
+			{
+				Tjost_View *tv = _view_push(L, host);
+				tv->size = 4;
+				tv->buf = m;
+				tv->midi = 1;
+				return ptr;
+			}
+
 			Tjost_Midi *tm = lua_newuserdata(L, sizeof(Tjost_Midi));
 			luaL_getmetatable(L, "Tjost_Midi");
 			lua_setmetatable(L, -2);
@@ -137,6 +223,97 @@ _push(Tjost_Host *host, osc_type_t type, osc_data_t *ptr)
 	}
 }
 
+static void
+_watchdog_hook(lua_State *L, lua_Debug *ar)
+{
+	Tjost_Host *host;
+	lua_getallocf(L, (void **)&host);
+	Tjost_Watchdog *watchdog = &host->watchdog;
+
+	if(!watchdog->armed) // outside of callbacks
+		return;
+
+	watchdog->count += watchdog->step;
+
+	const char *what = NULL;
+	if(watchdog->instructions && (watchdog->count >= watchdog->instructions))
+		what = "instruction";
+	else if(watchdog->deadline && (uv_hrtime() > watchdog->deadline))
+		what = "time";
+
+	if(what)
+	{
+		watchdog->tripped = 1;
+		lua_getinfo(L, "Sl", ar);
+		lua_pushfstring(L, "watchdog: %s limit exceeded at %s:%d", what, ar->short_src, ar->currentline);
+		lua_error(L); // unwinds to lua_pcall in _call
+	}
+}
+
+// (un)install hook on configuration changes only, not around every callback
+static void
+_watchdog_set(Tjost_Host *host)
+{
+	Tjost_Watchdog *watchdog = &host->watchdog;
+
+	if(watchdog->instructions || watchdog->time)
+	{
+		watchdog->step = watchdog->instructions && (watchdog->instructions < TJOST_WATCHDOG_STEP)
+			? watchdog->instructions
+			: TJOST_WATCHDOG_STEP;
+		lua_sethook(host->L, _watchdog_hook, LUA_MASKCOUNT, watchdog->step);
+	}
+	else
+		lua_sethook(host->L, NULL, 0, 0);
+}
+
+// call responder function under supervision of the watchdog
+static void
+_call(Tjost_Module *module, int nargs)
+{
+	Tjost_Host *host = module->host;
+	Tjost_Watchdog *watchdog = &host->watchdog;
+	lua_State *L = host->L;
+	int armed = watchdog->instructions || watchdog->time;
+
+	if(!module->has_lua_callback) // disabled by watchdog
+	{
+		lua_pop(L, nargs + 1);
+		return;
+	}
+
+	if(armed)
+	{
+		watchdog->count = 0;
+		watchdog->tripped = 0;
+		watchdog->deadline = watchdog->time ? uv_hrtime() + watchdog->time : 0;
+		watchdog->armed = 1;
+	}
+
+	if(lua_pcall(L, nargs, 0, 0))
+	{
+		if(armed && watchdog->tripped)
+			tjost_host_message_push(host, "Lua: callback of module %s aborted '%s'", module->name, lua_tostring(L, -1));
+		else
+			tjost_host_message_push(host, "Lua: callback error '%s'", lua_tostring(L, -1));
+		lua_pop(L, 1); // error message
+	}
+
+	_view_release(L, host);
+
+	if(armed)
+	{
+		watchdog->armed = 0;
+
+		if(watchdog->tripped && watchdog->strikes && (++module->strikes >= watchdog->strikes))
+		{
+			module->has_lua_callback = 0;
+			tjost_host_message_push(host, "Lua: responder of module %s disabled after %i watchdog violations",
+				module->name, module->strikes);
+		}
+	}
+}
+
 static int
 _deserialize(osc_time_t time, const char *path, const char *fmt, osc_data_t *buf, size_t size, void *dat)
 {
@@ -159,10 +336,9 @@ _deserialize(osc_time_t time, const char *path, const char *fmt, osc_data_t *buf
 
 		const char *type;
 		for(type=fmt; *type!='\0'; type++)
-			ptr = _push(host, *type, ptr);
+			ptr = _push(L, host, *type, ptr, module->borrow);
 
-		if(lua_pcall(L, argc, 0, 0))
-			tjost_host_message_push(host, "Lua: callback error '%s'", lua_tostring(L, -1));
+		_call(module, argc);
 	}
 
 	return 1;
@@ -187,8 +363,7 @@ _bundle_in(osc_time_t time, void *dat)
 		lua_pushstring(L, TJOST_BUNDLE_PUSH_PATH);
 		lua_pushstring(L, TJOST_BUNDLE_PUSH_FMT);
 
-		if(lua_pcall(L, 3, 0, 0))
-			tjost_host_message_push(host, "Lua: callback error '%s'", lua_tostring(L, -1));
+		_call(module, 3);
 	}
 }
 
@@ -206,23 +381,309 @@ _bundle_out(osc_time_t time, void *dat)
 		lua_pushstring(L, TJOST_BUNDLE_POP_PATH);
 		lua_pushstring(L, TJOST_BUNDLE_POP_FMT);
 
-		if(lua_pcall(L, 3, 0, 0))
-			tjost_host_message_push(host, "Lua: callback error '%s'", lua_tostring(L, -1));
+		_call(module, 3);
+	}
+}
+
+static void
+_batch_push(Tjost_Batch *batch, Tjost_Event *tev)
+{
+	Tjost_Host *host = batch->module->host;
+
+	if(batch->count == batch->size)
+	{
+		unsigned int size = batch->size ? batch->size * 2 : TJOST_BATCH_SIZE;
+		Tjost_Event **evs = batch->evs
+			? tjost_heap_realloc(host, TJOST_HEAP_EVENT, size * sizeof(Tjost_Event *), batch->evs)
+			: tjost_heap_alloc(host, TJOST_HEAP_EVENT, size * sizeof(Tjost_Event *));
+
+		if(!evs)
+		{
+			tjost_host_message_push(host, "Lua: %s", "batch overflow");
+			return;
+		}
+
+		batch->evs = evs;
+		batch->size = size;
 	}
+
+	batch->evs[batch->count++] = tjost_event_ref(tev);
 }
 
+// time is the due time in this period, shared events keep their own,
+// batches take it from the event as they are never fed deferred events
 void
-tjost_lua_deserialize(Tjost_Event *tev)
+tjost_lua_deserialize(Tjost_Module *module, Tjost_Event *tev, jack_nframes_t time)
+{
+	if(module->batch)
+	{
+		_batch_push(module->batch, tev);
+
+		if(module->batch->mode == TJOST_BATCH_BUNDLE)
+			tjost_lua_flush(module);
+	}
+	else
+		osc_dispatch_method(time, tev->buf, tev->size, methods, _bundle_in, _bundle_out, module);
+}
+
+void
+tjost_lua_flush(Tjost_Module *module)
+{
+	Tjost_Batch *batch = module->batch;
+
+	if(!batch || !batch->count)
+		return;
+
+	Tjost_Host *host = module->host;
+	lua_State *L = host->L;
+
+	// rewind iterator
+	batch->idx = 0;
+	batch->depth = 0;
+
+	lua_pushlightuserdata(L, module);
+	lua_rawget(L, LUA_REGISTRYINDEX); // responder function
+	{
+		lua_rawgeti(L, LUA_REGISTRYINDEX, batch->ref); // batch iterator
+
+		_call(module, 1);
+	}
+
+	unsigned int i;
+	for(i=0; i<batch->count; i++)
+		tjost_event_unref(host, batch->evs[i]);
+	batch->count = 0;
+	batch->deferred = 0;
+}
+
+static int
+_batch_packet(lua_State *L, Tjost_Batch *batch, osc_data_t *buf, size_t size)
+{
+	Tjost_Host *host = batch->module->host;
+
+	switch(*buf)
+	{
+		case '#':
+		{
+			if(batch->depth >= TJOST_BATCH_DEPTH)
+			{
+				tjost_host_message_push(host, "Lua: %s", "batch bundle nesting too deep");
+				return 0;
+			}
+
+			batch->ptr[batch->depth] = buf + 16; // skip '#bundle' and timetag
+			batch->end[batch->depth] = buf + size;
+			batch->depth++;
+
+			lua_pushnumber(L, batch->time);
+			lua_pushstring(L, TJOST_BUNDLE_PUSH_PATH);
+			lua_pushstring(L, TJOST_BUNDLE_PUSH_FMT);
+			return 3;
+		}
+		case '/':
+		{
+			const char *path;
+			const char *fmt;
+			osc_data_t *ptr = buf;
+
+			ptr = osc_get_path(ptr, &path);
+			ptr = osc_get_fmt(ptr, &fmt);
+			fmt++; // skip ','
+
+			int argc = 3 + strlen(fmt);
+			if(!lua_checkstack(L, argc + 32)) // ensure at least that many free slots on stack
+				tjost_host_message_push(host, "Lua: %s", "stack overflow");
+
+			lua_pushnumber(L, batch->time);
+			lua_pushstring(L, path);
+			lua_pushstring(L, fmt);
+
+			const char *type;
+			for(type=fmt; *type!='\0'; type++)
+				ptr = _push(L, host, *type, ptr, batch->module->borrow);
+			return argc;
+		}
+		default:
+			tjost_host_message_push(host, "Lua: %s", "invalid OSC packet in batch");
+			return 0;
+	}
+}
+
+// generic for iterator, returns the same arguments as the unbatched callback
+static int
+_call_batch(lua_State *L)
 {
-	osc_dispatch_method(tev->time, tev->buf, tev->size, methods, _bundle_in, _bundle_out, tev->module);
+	Tjost_Batch *batch = luaL_checkudata(L, 1, "Tjost_Batch");
+	int n;
+
+	// views of previous iteration expire
+	_view_release(L, batch->module->host);
+
+	while(1)
+	{
+		if(batch->depth > 0) // inside bundle
+		{
+			int d = batch->depth - 1;
+
+			if(batch->ptr[d] < batch->end[d])
+			{
+				int32_t size;
+				osc_data_t *elem = osc_get_int32(batch->ptr[d], &size);
+				batch->ptr[d] = elem + size;
+
+				if((n = _batch_packet(L, batch, elem, size)))
+					return n;
+			}
+			else
+			{
+				batch->depth--;
+
+				lua_pushnumber(L, batch->time);
+				lua_pushstring(L, TJOST_BUNDLE_POP_PATH);
+				lua_pushstring(L, TJOST_BUNDLE_POP_FMT);
+				return 3;
+			}
+		}
+		else if(batch->idx < batch->count)
+		{
+			Tjost_Event *tev = batch->evs[batch->idx++];
+			batch->time = tev->time;
+
+			if(!osc_check_packet(tev->buf, tev->size))
+				continue;
+
+			if((n = _batch_packet(L, batch, tev->buf, tev->size)))
+				return n;
+		}
+		else
+			return 0; // end of batch
+	}
+}
+
+static int
+_len_batch(lua_State *L)
+{
+	Tjost_Batch *batch = luaL_checkudata(L, 1, "Tjost_Batch");
+	lua_pushnumber(L, batch->count);
+	return 1;
+}
+
+static void
+_batch_new(lua_State *L, Tjost_Module *module, const char *mode)
+{
+	Tjost_Host *host = module->host;
+
+	Tjost_Batch *batch = lua_newuserdata(L, sizeof(Tjost_Batch));
+	memset(batch, 0, sizeof(Tjost_Batch));
+	luaL_getmetatable(L, "Tjost_Batch");
+	lua_setmetatable(L, -2);
+
+	batch->module = module;
+	if(!strcmp(mode, "period"))
+		batch->mode = TJOST_BATCH_PERIOD;
+	else if(!strcmp(mode, "bundle"))
+		batch->mode = TJOST_BATCH_BUNDLE;
+	else
+		tjost_host_message_push(host, "Lua: invalid batch mode %s", mode);
+
+	batch->ref = luaL_ref(L, LUA_REGISTRYINDEX); // keep batch alive as long as module
+	module->batch = batch;
+}
+
+static void
+_batch_free(lua_State *L, Tjost_Module *module)
+{
+	Tjost_Batch *batch = module->batch;
+	Tjost_Host *host = module->host;
+
+	if(!batch)
+		return;
+
+	unsigned int i;
+	for(i=0; i<batch->count; i++)
+		tjost_event_unref(host, batch->evs[i]);
+	if(batch->evs)
+		tjost_heap_free(host, TJOST_HEAP_EVENT, batch->evs);
+
+	luaL_unref(L, LUA_REGISTRYINDEX, batch->ref);
+	module->batch = NULL;
+}
+
+static void
+_router_free(lua_State *L, Tjost_Module *module)
+{
+	Tjost_Router *router = module->route;
+
+	if(!router)
+		return;
+
+	luaL_unref(L, LUA_REGISTRYINDEX, router->ref);
+	tjost_router_free(module->host, router);
+	module->route = NULL;
+}
+
+// host pipes outlive modules, drop their source entries so addresses can be reused
+static void
+_pipes_forget(Tjost_Module *module)
+{
+	Tjost_Host *host = module->host;
+
+	tjost_pipe_forget(&host->pipe_uplink_tx, module);
+	tjost_pipe_forget(&host->pipe_uplink_rx, module);
+}
+
+// serialization state is only needed by modules called from Lua, allocate it on demand
+static inline Tjost_Serializer *
+_serializer_get(Tjost_Module *module)
+{
+	Tjost_Host *host = module->host;
+
+	if(!module->ser)
+	{
+		if(!(module->ser = tjost_alloc(host, sizeof(Tjost_Serializer) + module->ser_size)))
+			return NULL;
+		memset(module->ser, 0, sizeof(Tjost_Serializer));
+	}
+
+	return module->ser;
+}
+
+static void
+_serializer_free(Tjost_Module *module)
+{
+	Tjost_Serializer *ser = module->ser;
+	Tjost_Host *host = module->host;
+
+	if(!ser)
+		return;
+
+	// unbalanced bundle pushes
+	Eina_Inlist *l;
+	Tjost_Bundle *bndl;
+	EINA_INLIST_FOREACH_SAFE(ser->bndls, l, bndl)
+	{
+		ser->bndls = eina_inlist_remove(ser->bndls, EINA_INLIST_GET(bndl));
+		tjost_free(host, bndl);
+	}
+
+	tjost_free(host, ser);
+	module->ser = NULL;
 }
 
 static inline int
 _serialize_packet(lua_State *L, Tjost_Module *module)
 {
 	Tjost_Host *host = module->host;
-	osc_data_t *ptr = module->buf_ptr;
-	osc_data_t *end = module->buffer + TJOST_BUF_SIZE;
+	Tjost_Serializer *ser = _serializer_get(module);
+
+	if(!ser)
+	{
+		tjost_host_message_push(host, "Lua: no serialization buffer");
+		return 0;
+	}
+
+	osc_data_t *ptr = ser->ptr;
+	osc_data_t *end = ser->buf + module->ser_size;
 
 	int has_timestamp = lua_isnumber(L, 2);
 	int pos = 2 + has_timestamp;
@@ -235,31 +696,31 @@ _serialize_packet(lua_State *L, Tjost_Module *module)
 
 	if(!strcmp(path, TJOST_BUNDLE_PUSH_PATH) && !strcmp(fmt, TJOST_BUNDLE_PUSH_FMT))
 	{
-		int bundle_element = eina_inlist_count(module->bndls) > 0;
+		int bundle_element = eina_inlist_count(ser->bndls) > 0;
 		if(!bundle_element)
-			ptr = module->buffer;
+			ptr = ser->buf;
 		else // bundle_element
-			ptr = osc_start_bundle_item(ptr, end, &module->itm);
+			ptr = osc_start_bundle_item(ptr, end, &ser->itm);
 		Tjost_Bundle *bndl = tjost_alloc(host, sizeof(Tjost_Bundle));
-		module->bndls = eina_inlist_prepend(module->bndls, EINA_INLIST_GET(bndl));
+		ser->bndls = eina_inlist_prepend(ser->bndls, EINA_INLIST_GET(bndl));
 		//bndl->time = time;
 		ptr = osc_start_bundle(ptr, end, OSC_IMMEDIATE, &bndl->ptr); //FIXME how to handle timestamp?
 	}
 	else if(!strcmp(path, TJOST_BUNDLE_POP_PATH) && !strcmp(fmt, TJOST_BUNDLE_POP_FMT))
 	{
-		Tjost_Bundle *bndl = EINA_INLIST_CONTAINER_GET(module->bndls, Tjost_Bundle);
-		module->bndls = eina_inlist_remove(module->bndls, EINA_INLIST_GET(bndl));
+		Tjost_Bundle *bndl = EINA_INLIST_CONTAINER_GET(ser->bndls, Tjost_Bundle);
+		ser->bndls = eina_inlist_remove(ser->bndls, EINA_INLIST_GET(bndl));
 		ptr = osc_end_bundle(ptr, end, bndl->ptr);
 		
-		int bundle_element = eina_inlist_count(module->bndls) > 0;
+		int bundle_element = eina_inlist_count(ser->bndls) > 0;
 		if(!bundle_element)
 		{
-			size_t size = ptr - module->buffer;
+			size_t size = ptr - ser->buf;
 			if(size > 0)
-				tjost_module_schedule(module, time, size, module->buffer);
+				tjost_module_schedule(module, time, size, ser->buf);
 		}
 		else // bundle_element
-			ptr = osc_end_bundle_item(ptr, end, module->itm);
+			ptr = osc_end_bundle_item(ptr, end, ser->itm);
 
 		tjost_free(host, bndl);
 	}
@@ -267,9 +728,9 @@ _serialize_packet(lua_State *L, Tjost_Module *module)
 	{
 		osc_data_t *itm;
 
-		int bundle_element = eina_inlist_count(module->bndls) > 0;
+		int bundle_element = eina_inlist_count(ser->bndls) > 0;
 		if(!bundle_element)
-			ptr = module->buffer;
+			ptr = ser->buf;
 		else // bundle_element
 			ptr = osc_start_bundle_item(ptr, end, &itm);
 
@@ -302,6 +763,12 @@ _serialize_packet(lua_State *L, Tjost_Module *module)
 					ptr = osc_set_string(ptr, end, luaL_checkstring(L, p));
 					break;
 				case OSC_BLOB:
+					if(_is_view(L, p))
+					{
+						Tjost_View *tv = _check_view(L, p);
+						ptr = osc_set_blob(ptr, end, tv->size, tv->buf);
+					}
+					else
 					{
 						Tjost_Blob *tb = luaL_checkudata(L, p, "Tjost_Blob");
 						ptr = osc_set_blob(ptr, end, tb->size, tb->buf);
@@ -328,6 +795,13 @@ _serialize_packet(lua_State *L, Tjost_Module *module)
 					ptr = osc_set_symbol(ptr, end, luaL_checkstring(L, p));
 					break;
 				case OSC_MIDI:
+					if(_is_view(L, p))
+					{
+						Tjost_View *tv = _check_view(L, p);
+						luaL_argcheck(L, tv->midi, p, "MIDI view expected");
+						ptr = osc_set_midi(ptr, end, tv->buf);
+					}
+					else
 					{
 						Tjost_Midi *tm = luaL_checkudata(L, p, "Tjost_Midi");
 						ptr = osc_set_midi(ptr, end, tm->buf);
@@ -344,15 +818,15 @@ _serialize_packet(lua_State *L, Tjost_Module *module)
 
 		if(!bundle_element)
 		{
-			size_t size = ptr - module->buffer;
+			size_t size = ptr - ser->buf;
 			if(ptr && (size > 0))
-				tjost_module_schedule(module, time, size, module->buffer);
+				tjost_module_schedule(module, time, size, ser->buf);
 		}
 		else // bundle_element
 			ptr = osc_end_bundle_item(ptr, end, itm);
 	}
 	
-	module->buf_ptr = ptr;
+	ser->ptr = ptr;
 
 	return 0;
 }
@@ -378,21 +852,6 @@ _call_uplink(lua_State *L)
 	return _serialize_packet(L, module);
 }
 
-static inline void
-_clear(Tjost_Module *module)
-{
-	Tjost_Host *host = module->host;
-
-	// drain event queue
-	Eina_Inlist *l;
-	Tjost_Event *tev;
-	EINA_INLIST_FOREACH_SAFE(module->queue, l, tev)
-	{
-		module->queue = eina_inlist_remove(module->queue, EINA_INLIST_GET(tev));
-		tjost_free(host, tev);
-	}
-}
-
 static int
 _gc_input(lua_State *L)
 {
@@ -404,10 +863,13 @@ _gc_input(lua_State *L)
 	lua_pushlightuserdata(L, module);
 	lua_pushnil(L);
 	lua_rawset(L, LUA_REGISTRYINDEX);
-	lua_gc(host->L, LUA_GCSTEP, 0);
+	_batch_free(L, module);
+	_router_free(L, module);
 
 	module->del(module);
+	_pipes_forget(module);
 	host->modules = eina_inlist_remove(host->modules, EINA_INLIST_GET(module));
+	host->routing.dirty = 1;
 
 	Eina_Inlist *l;
 	Tjost_Child *child;
@@ -431,11 +893,14 @@ _gc_output(lua_State *L)
 	lua_pushlightuserdata(L, module);
 	lua_pushnil(L);
 	lua_rawset(L, LUA_REGISTRYINDEX);
-	lua_gc(host->L, LUA_GCSTEP, 0);
+	_batch_free(L, module);
 
 	module->del(module);
-	_clear(module);
+	_pipes_forget(module);
+	tjost_module_queue_deinit(module);
+	_serializer_free(module);
 	host->modules = eina_inlist_remove(host->modules, EINA_INLIST_GET(module));
+	host->routing.dirty = 1;
 
 	return 0;
 }
@@ -451,11 +916,15 @@ _gc_in_out(lua_State *L)
 	lua_pushlightuserdata(L, module);
 	lua_pushnil(L);
 	lua_rawset(L, LUA_REGISTRYINDEX);
-	lua_gc(host->L, LUA_GCSTEP, 0);
+	_batch_free(L, module);
+	_router_free(L, module);
 
 	module->del(module);
-	_clear(module);
+	_pipes_forget(module);
+	tjost_module_queue_deinit(module);
+	_serializer_free(module);
 	host->modules = eina_inlist_remove(host->modules, EINA_INLIST_GET(module));
+	host->routing.dirty = 1;
 
 	Eina_Inlist *l;
 	Tjost_Child *child;
@@ -479,11 +948,14 @@ _gc_uplink(lua_State *L)
 	lua_pushlightuserdata(L, module);
 	lua_pushnil(L);
 	lua_rawset(L, LUA_REGISTRYINDEX);
-	lua_gc(host->L, LUA_GCSTEP, 0);
+	_batch_free(L, module);
 
 	module->del(module);
-	_clear(module);
+	_pipes_forget(module);
+	tjost_module_queue_deinit(module);
+	_serializer_free(module);
 	host->uplinks = eina_inlist_remove(host->uplinks, EINA_INLIST_GET(module));
+	host->routing.dirty = 1;
 
 	return 0;
 }
@@ -492,7 +964,7 @@ static int
 _clear_output(lua_State *L)
 {
 	Tjost_Module *module = luaL_checkudata(L, 1, "Tjost_Output");
-	_clear(module);
+	tjost_module_queue_clear(module);
 	return 0;
 }
 
@@ -500,7 +972,7 @@ static int
 _clear_in_out(lua_State *L)
 {
 	Tjost_Module *module = luaL_checkudata(L, 1, "Tjost_In_Out");
-	_clear(module);
+	tjost_module_queue_clear(module);
 	return 0;
 }
 
@@ -508,7 +980,7 @@ static int
 _clear_uplink(lua_State *L)
 {
 	Tjost_Module *module = luaL_checkudata(L, 1, "Tjost_Uplink");
-	_clear(module);
+	tjost_module_queue_clear(module);
 	return 0;
 }
 
@@ -588,6 +1060,73 @@ _len_midi(lua_State *L)
 	return 1;
 }
 
+static int
+_index_view(lua_State *L)
+{
+	Tjost_View *tv = _check_view(L, 1);
+	int typ = lua_type(L, 2);
+	if(typ == LUA_TNUMBER)
+	{
+		int index = luaL_checkint(L, 2);
+		if( (index >= 0) && (index < tv->size) )
+			lua_pushnumber(L, tv->buf[index]);
+		else
+			lua_pushnil(L);
+	}
+	else if( (typ == LUA_TSTRING) && !strcmp(lua_tostring(L, 2), "raw") ) // writable and would outlive the view
+		return luaL_error(L, "view has no raw pointer, use :copy() to get one");
+	else if(typ == LUA_TSTRING) // methods
+	{
+		lua_getmetatable(L, 1);
+		lua_pushvalue(L, 2);
+		lua_rawget(L, -2);
+	}
+	else
+		lua_pushnil(L);
+	return 1;
+}
+
+static int
+_newindex_view(lua_State *L)
+{
+	return luaL_error(L, "view is read-only, use :copy() to modify it");
+}
+
+static int
+_len_view(lua_State *L)
+{
+	Tjost_View *tv = _check_view(L, 1);
+	lua_pushnumber(L, tv->size);
+	return 1;
+}
+
+// turn a borrowed view into an owned blob or MIDI userdata
+static int
+_copy_view(lua_State *L)
+{
+	Tjost_View *tv = _check_view(L, 1);
+
+	if(tv->midi)
+	{
+		Tjost_Midi *tm = lua_newuserdata(L, sizeof(Tjost_Midi));
+		luaL_getmetatable(L, "Tjost_Midi");
+		lua_setmetatable(L, -2);
+
+		memcpy(tm->buf, tv->buf, 4);
+	}
+	else
+	{
+		Tjost_Blob *tb = lua_newuserdata(L, sizeof(Tjost_Blob) + tv->size);
+		luaL_getmetatable(L, "Tjost_Blob");
+		lua_setmetatable(L, -2);
+
+		tb->size = tv->size;
+		memcpy(tb->buf, tv->buf, tv->size);
+	}
+
+	return 1;
+}
+
 const luaL_Reg tjost_input_mt [] = {
 	{"__gc", _gc_input},
 	{NULL, NULL}
@@ -628,6 +1167,20 @@ const luaL_Reg tjost_midi_mt [] = {
 	{NULL, NULL}
 };
 
+const luaL_Reg tjost_view_mt [] = {
+	{"__index", _index_view},
+	{"__newindex", _newindex_view},
+	{"__len", _len_view},
+	{"copy", _copy_view},
+	{NULL, NULL}
+};
+
+const luaL_Reg tjost_batch_mt [] = {
+	{"__call", _call_batch},
+	{"__len", _len_batch},
+	{NULL, NULL}
+};
+
 static int
 _plugin(lua_State *L)
 {
@@ -644,6 +1197,8 @@ _plugin(lua_State *L)
 
 	if(!(mod = eina_module_find(host->arr, name)))
 		fprintf(stderr, "could not find module '%s'\n", name);
+	if(name)
+		strncpy(module->name, name, TJOST_MODULE_NAME_SIZE - 1);
 	if(!(module->add = eina_module_symbol_get(mod, "add")))
 		fprintf(stderr, "could not get 'add' symbol\n");
 	if(!(module->del = eina_module_symbol_get(mod, "del")))
@@ -653,6 +1208,67 @@ _plugin(lua_State *L)
 
 	module->host = host;
 
+	// pass blob and MIDI arguments as views valid during the callback only?
+	lua_getfield(L, 1, "borrow");
+	module->borrow = lua_toboolean(L, -1);
+	lua_pop(L, 1);
+
+	// may Lua callback be deferred when cycle budget is exhausted?
+	lua_getfield(L, 1, "best_effort");
+	module->best_effort = lua_toboolean(L, -1);
+	lua_pop(L, 1);
+
+	// size of buffer for messages sent from Lua
+	lua_getfield(L, 1, "buffer");
+	module->ser_size = luaL_optnumber(L, -1, TJOST_BUF_SIZE);
+	lua_pop(L, 1);
+
+	// max bytes of queued events, 0 for unlimited
+	lua_getfield(L, 1, "quota");
+	module->quota.limit = luaL_optnumber(L, -1, 0);
+	lua_pop(L, 1);
+
+	// what to do with events over quota
+	lua_getfield(L, 1, "overflow");
+	const char *overflow = luaL_optstring(L, -1, "drop");
+	if(!strcmp(overflow, "drop"))
+		module->quota.policy = TJOST_QUOTA_DROP;
+	else if(!strcmp(overflow, "warn"))
+		module->quota.policy = TJOST_QUOTA_WARN;
+	else
+		fprintf(stderr, "unknown overflow policy '%s'\n", overflow);
+	lua_pop(L, 1);
+
+	// capacity of pipes to and from the main loop in bytes
+	lua_getfield(L, 1, "pipe_size");
+	module->pipe_size = luaL_optnumber(L, -1, 0);
+	lua_pop(L, 1);
+
+	// what pipes do when full
+	lua_getfield(L, 1, "pipe_overflow");
+	const char *pipe_overflow = luaL_optstring(L, -1, "drop_newest");
+	if(!strcmp(pipe_overflow, "drop_newest"))
+		module->pipe_policy = TJOST_PIPE_DROP_NEWEST;
+	else if(!strcmp(pipe_overflow, "drop_oldest"))
+		module->pipe_policy = TJOST_PIPE_DROP_OLDEST;
+	else if(!strcmp(pipe_overflow, "coalesce"))
+		module->pipe_policy = TJOST_PIPE_COALESCE;
+	else if(!strcmp(pipe_overflow, "block"))
+		module->pipe_policy = TJOST_PIPE_BLOCK;
+	else
+		fprintf(stderr, "unknown pipe overflow policy '%s'\n", pipe_overflow);
+	lua_pop(L, 1);
+
+	// wake up main loop consumer only once this many bytes are pending, for non-urgent consumers like file writers
+	lua_getfield(L, 1, "wakeup_fill");
+	module->wakeup_fill = luaL_optnumber(L, -1, 0);
+	lua_pop(L, 1);
+
+	// max latency in s before main loop consumer is woken up anyway
+	lua_getfield(L, 1, "wakeup_latency");
+	module->wakeup_latency = luaL_optnumber(L, -1, module->wakeup_fill ? TJOST_WAKEUP_LATENCY : 0) * host->srate;
+	lua_pop(L, 1);
+
 	// has a responder function ? TODO check Output of Uplink
 	if(lua_gettop(L) > 2)
 		switch(lua_type(L, 2))
@@ -665,6 +1281,14 @@ _plugin(lua_State *L)
 				lua_pushlightuserdata(L, module);
 				lua_pushvalue(L, 2); // responder function
 				lua_rawset(L, LUA_REGISTRYINDEX);
+
+				// deliver events once per period or bundle instead of per message?
+				lua_getfield(L, 1, "batch");
+				const char *batch = luaL_optstring(L, -1, NULL);
+				lua_pop(L, 1);
+
+				if(batch)
+					_batch_new(L, module, batch);
 				break;
 			}
 			case LUA_TUSERDATA:
@@ -733,6 +1357,7 @@ _plugin(lua_State *L)
 			lua_setmetatable(L, -2);
 			break;
 	}
+	host->routing.dirty = 1;
 
 	return 1;
 }
@@ -749,6 +1374,7 @@ _chain(lua_State *L)
 		Tjost_Child *child = tjost_alloc(host, sizeof(Tjost_Child));
 		child->module = mod_out;
 		mod_in->children = eina_inlist_append(mod_in->children, EINA_INLIST_GET(child));
+		host->routing.dirty = 1;
 	}
 	else
 		fprintf(stderr, "could not setup module chain\n");
@@ -756,6 +1382,113 @@ _chain(lua_State *L)
 	return 0;
 }
 
+// module userdata at given stack index or NULL
+static Tjost_Module *
+_module_test(lua_State *L, int idx)
+{
+	static const char *mts [] = {"Tjost_Input", "Tjost_Output", "Tjost_In_Out", "Tjost_Uplink", NULL};
+	const char **mt;
+
+	if(!lua_isuserdata(L, idx) || !lua_getmetatable(L, idx))
+		return NULL;
+
+	for(mt=mts; *mt; mt++)
+	{
+		luaL_getmetatable(L, *mt);
+		int equal = lua_rawequal(L, -1, -2);
+		lua_pop(L, 1);
+
+		if(equal)
+		{
+			lua_pop(L, 1); // metatable
+			return lua_touserdata(L, idx);
+		}
+	}
+
+	lua_pop(L, 1); // metatable
+	return NULL;
+}
+
+static int
+_route(lua_State *L)
+{
+	Tjost_Module *module = _module_test(L, 1);
+	luaL_checktype(L, 2, LUA_TTABLE);
+
+	if(!module || !(module->type & TJOST_MODULE_INPUT))
+	{
+		fprintf(stderr, "could not setup module route\n");
+		return 0;
+	}
+
+	Tjost_Host *host = module->host;
+
+	// copy valid routes to a private table, the caller may alter its own later on
+	unsigned int count = 0;
+	size_t len = 0;
+	lua_newtable(L);
+	lua_pushnil(L);
+	while(lua_next(L, 2))
+	{
+		const char *path = lua_type(L, -2) == LUA_TSTRING ? lua_tostring(L, -2) : NULL;
+		Tjost_Module *target = _module_test(L, -1);
+
+		if(!path || !osc_check_path(path) || !target || !(target->type & TJOST_MODULE_OUTPUT))
+			fprintf(stderr, "could not setup route for '%s'\n", path ? path : "?");
+		else
+		{
+			count++;
+			len += lua_objlen(L, -2) + 1;
+
+			lua_pushvalue(L, -2); // path
+			lua_pushvalue(L, -2); // target
+			lua_rawset(L, -5);
+		}
+		lua_pop(L, 1);
+	}
+
+	Tjost_Router *router = tjost_router_new(host, count, len);
+	if(!router)
+	{
+		fprintf(stderr, "could not allocate module route\n");
+		return 0;
+	}
+
+	lua_pushnil(L);
+	while(lua_next(L, -2))
+	{
+		const char *path = lua_tostring(L, -2);
+		Tjost_Module *target = lua_touserdata(L, -1);
+
+		if(tjost_router_add(router, path, target))
+			fprintf(stderr, "duplicate route for '%s'\n", path);
+		lua_pop(L, 1);
+	}
+
+	// keep private route table and thus target modules alive
+	router->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	// has a fallback responder function for unmatched paths?
+	switch(lua_type(L, 3))
+	{
+		case LUA_TTABLE:
+		case LUA_TFUNCTION:
+			module->has_lua_callback = 1;
+
+			lua_pushlightuserdata(L, module);
+			lua_pushvalue(L, 3); // responder function
+			lua_rawset(L, LUA_REGISTRYINDEX);
+			break;
+		default:
+			break;
+	}
+
+	_router_free(L, module);
+	module->route = router;
+
+	return 0;
+}
+
 static int
 _blob(lua_State *L)
 {
@@ -781,6 +1514,321 @@ _midi(lua_State *L)
 	return 1;
 }
 
+static int
+_budget(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+
+	// share of period available for event handling, 0 for unlimited
+	if(lua_gettop(L) > 0)
+		host->budget.fraction = luaL_checknumber(L, 1);
+
+	lua_pushnumber(L, host->budget.fraction);
+	return 1;
+}
+
+static int
+_gc(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+	Tjost_Gc *gc = &host->gc;
+
+	if(lua_istable(L, 1))
+	{
+		// share of period garbage collection may run up to
+		lua_getfield(L, 1, "fraction");
+		gc->fraction = luaL_optnumber(L, -1, gc->fraction);
+		lua_pop(L, 1);
+
+		// smallest step in KB
+		lua_getfield(L, 1, "min");
+		gc->min = luaL_optinteger(L, -1, gc->min);
+		lua_pop(L, 1);
+
+		// largest step in KB, 0 for unlimited
+		lua_getfield(L, 1, "max");
+		gc->max = luaL_optinteger(L, -1, gc->max);
+		lua_pop(L, 1);
+	}
+
+	lua_createtable(L, 0, 5);
+	lua_pushnumber(L, gc->average / 1000);
+		lua_setfield(L, -2, "average"); // us per period
+	lua_pushnumber(L, gc->cost);
+		lua_setfield(L, -2, "cost"); // ns per KB
+	lua_pushnumber(L, gc->count);
+		lua_setfield(L, -2, "count"); // KB
+	lua_pushnumber(L, gc->skipped);
+		lua_setfield(L, -2, "skipped");
+	lua_pushnumber(L, gc->forced);
+		lua_setfield(L, -2, "forced");
+
+	return 1;
+}
+
+static int
+_watchdog(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+	Tjost_Watchdog *watchdog = &host->watchdog;
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	// max instructions per callback, 0 for unlimited
+	lua_getfield(L, 1, "instructions");
+	watchdog->instructions = luaL_optinteger(L, -1, watchdog->instructions);
+	lua_pop(L, 1);
+
+	// max time per callback in ms, 0 for unlimited
+	lua_getfield(L, 1, "time");
+	if(!lua_isnil(L, -1))
+		watchdog->time = luaL_checknumber(L, -1) * 1e6;
+	lua_pop(L, 1);
+
+	// violations until responder is disabled, 0 for never
+	lua_getfield(L, 1, "strikes");
+	watchdog->strikes = luaL_optinteger(L, -1, watchdog->strikes);
+	lua_pop(L, 1);
+
+	_watchdog_set(host);
+
+	return 0;
+}
+
+static int
+_quota(lua_State *L)
+{
+	Tjost_Module *module = _module_test(L, 1);
+	if(!module)
+		return luaL_argerror(L, 1, "module expected");
+	Tjost_Quota *quota = &module->quota;
+
+	lua_createtable(L, 0, 5);
+	lua_pushnumber(L, quota->limit);
+		lua_setfield(L, -2, "limit");
+	lua_pushnumber(L, quota->used);
+		lua_setfield(L, -2, "used");
+	lua_pushnumber(L, quota->peak);
+		lua_setfield(L, -2, "peak");
+	lua_pushnumber(L, quota->dropped);
+		lua_setfield(L, -2, "dropped");
+	lua_pushnumber(L, quota->exceeded);
+		lua_setfield(L, -2, "exceeded");
+
+	return 1;
+}
+
+static void
+_pipe_push(lua_State *L, Tjost_Pipe *pipe)
+{
+	Tjost_Pipe_Stats *stats = &pipe->stats;
+
+	size_t fill = tjost_pipe_fill(pipe);
+
+	lua_createtable(L, 0, 7);
+	lua_pushnumber(L, fill + tjost_pipe_space(pipe));
+		lua_setfield(L, -2, "size");
+	lua_pushnumber(L, fill);
+		lua_setfield(L, -2, "fill");
+	lua_pushnumber(L, __atomic_load_n(&stats->high, __ATOMIC_RELAXED));
+		lua_setfield(L, -2, "high");
+	lua_pushnumber(L, __atomic_load_n(&stats->produced, __ATOMIC_RELAXED));
+		lua_setfield(L, -2, "produced");
+	lua_pushnumber(L, __atomic_load_n(&stats->bytes, __ATOMIC_RELAXED));
+		lua_setfield(L, -2, "bytes");
+	lua_pushnumber(L, __atomic_load_n(&stats->dropped, __ATOMIC_RELAXED));
+		lua_setfield(L, -2, "dropped");
+	lua_pushnumber(L, __atomic_load_n(&stats->discarded, __ATOMIC_RELAXED));
+		lua_setfield(L, -2, "discarded");
+}
+
+// statistics of the pipes of a module as array, or of the uplink pipes by name without argument
+static int
+_pipe(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+
+	if(!lua_isnoneornil(L, 1))
+	{
+		Tjost_Module *module = _module_test(L, 1);
+		if(!module)
+			return luaL_argerror(L, 1, "module or nil expected");
+
+		Tjost_Pipe *pipe;
+		int i = 1;
+
+		lua_createtable(L, eina_inlist_count(module->pipes), 0);
+		EINA_INLIST_FOREACH(module->pipes, pipe)
+		{
+			_pipe_push(L, pipe);
+			lua_rawseti(L, -2, i++);
+		}
+	}
+	else
+	{
+		lua_createtable(L, 0, 2);
+		_pipe_push(L, &host->pipe_uplink_rx);
+			lua_setfield(L, -2, "uplink_rx");
+		_pipe_push(L, &host->pipe_uplink_tx);
+			lua_setfield(L, -2, "uplink_tx");
+	}
+
+	return 1;
+}
+
+static int
+_memory(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+	Tjost_Slab *slab = &host->slab;
+	int i;
+
+	lua_newtable(L);
+
+	lua_createtable(L, TJOST_SLAB_CLASSES, 0);
+	for(i=0; i<TJOST_SLAB_CLASSES; i++)
+	{
+		Tjost_Slab_Class *klass = &slab->classes[i];
+
+		lua_createtable(L, 0, 4);
+		lua_pushnumber(L, klass->size);
+			lua_setfield(L, -2, "size");
+		lua_pushnumber(L, klass->used);
+			lua_setfield(L, -2, "used");
+		lua_pushnumber(L, klass->avail);
+			lua_setfield(L, -2, "free");
+		lua_pushnumber(L, klass->pages);
+			lua_setfield(L, -2, "pages");
+		lua_rawseti(L, -2, i+1);
+	}
+	lua_setfield(L, -2, "slabs");
+
+	lua_pushnumber(L, slab->large);
+		lua_setfield(L, -2, "large");
+
+	lua_createtable(L, 0, TJOST_HEAP_MAX);
+	for(i=0; i<TJOST_HEAP_MAX; i++)
+	{
+		Tjost_Heap *heap = &host->heaps[i];
+
+		lua_createtable(L, 0, 5);
+		lua_pushnumber(L, heap->sum);
+			lua_setfield(L, -2, "size");
+		lua_pushnumber(L, heap->used);
+			lua_setfield(L, -2, "used");
+		lua_pushnumber(L, heap->peak);
+			lua_setfield(L, -2, "peak");
+		lua_pushnumber(L, eina_inlist_count(heap->chunks));
+			lua_setfield(L, -2, "chunks");
+		lua_pushnumber(L, heap->failed);
+			lua_setfield(L, -2, "failed");
+		lua_setfield(L, -2, heap->name);
+	}
+	lua_setfield(L, -2, "heaps");
+
+	return 1;
+}
+
+static void
+_heap_reserve(Tjost_Host *host, Tjost_Heap *heap, size_t size)
+{
+	if(tjost_heap_reserve(host, heap, size))
+		fprintf(stderr, "could not reserve 0x%zx bytes for %s heap\n", size, heap->name);
+}
+
+static int
+_heap(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+	const char *name = luaL_checkstring(L, 1);
+	luaL_checktype(L, 2, LUA_TTABLE);
+
+	Tjost_Heap *heap = tjost_heap_find(host, name);
+	if(!heap)
+	{
+		fprintf(stderr, "could not find heap '%s'\n", name);
+		return 0;
+	}
+
+	// growth step in bytes
+	lua_getfield(L, 2, "step");
+	heap->step = luaL_optnumber(L, -1, heap->step);
+	lua_pop(L, 1);
+
+	// max size in bytes, 0 for unlimited
+	lua_getfield(L, 2, "max");
+	heap->max = luaL_optnumber(L, -1, heap->max);
+	lua_pop(L, 1);
+
+	// usage share triggering growth
+	lua_getfield(L, 2, "high");
+	heap->high = luaL_optnumber(L, -1, heap->high);
+	lua_pop(L, 1);
+
+	// usage share allowing release of free chunks
+	lua_getfield(L, 2, "low");
+	heap->low = luaL_optnumber(L, -1, heap->low);
+	lua_pop(L, 1);
+
+	// back new chunks with huge pages
+	lua_getfield(L, 2, "hugetlb");
+	if(!lua_isnil(L, -1))
+		heap->hugetlb = lua_toboolean(L, -1);
+	lua_pop(L, 1);
+
+	if(heap->hugetlb) // round up to whole huge pages
+		heap->step = (heap->step + TJOST_HUGE_PAGE_SIZE - 1) & ~(size_t)(TJOST_HUGE_PAGE_SIZE - 1);
+
+	// map chunks right now up to given size in bytes
+	lua_getfield(L, 2, "reserve");
+	size_t reserve = luaL_optnumber(L, -1, 0);
+	lua_pop(L, 1);
+
+	if(reserve)
+		_heap_reserve(host, heap, reserve);
+
+	return 0;
+}
+
+// map, prefault and lock expected memory per heap before activation,
+// shorthand for tjost.heap(name, {reserve=bytes}) on every given heap
+static int
+_reserve(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+	luaL_checktype(L, 1, LUA_TTABLE);
+	int i;
+
+	for(i=0; i<TJOST_HEAP_MAX; i++)
+	{
+		Tjost_Heap *heap = &host->heaps[i];
+
+		// size in bytes, by heap name
+		lua_getfield(L, 1, heap->name);
+		size_t size = luaL_optnumber(L, -1, 0);
+		lua_pop(L, 1);
+
+		if(size)
+			_heap_reserve(host, heap, size);
+	}
+
+	return 0;
+}
+
+// seconds between fragmentation reports of all heaps to uplinks, 0 for none
+static int
+_heap_report(lua_State *L)
+{
+	Tjost_Host *host = lua_touserdata(L, lua_upvalueindex(1));
+	double interval = luaL_checknumber(L, 1);
+
+	// heaps are reported one at a time, round robin
+	host->heap_report = interval > 0.0 ? interval * host->srate / TJOST_HEAP_MAX : 0;
+	host->heap_report_frames = 0;
+
+	return 0;
+}
+
 static int
 _hostname(lua_State *L)
 {
@@ -796,6 +1844,16 @@ _hostname(lua_State *L)
 const luaL_Reg tjost_globals [] = {
 	{"plugin", _plugin},
 	{"chain", _chain},
+	{"route", _route},
+	{"budget", _budget},
+	{"watchdog", _watchdog},
+	{"gc", _gc},
+	{"memory", _memory},
+	{"quota", _quota},
+	{"pipe", _pipe},
+	{"heap", _heap},
+	{"heap_report", _heap_report},
+	{"reserve", _reserve},
 	{"blob", _blob},
 	{"midi", _midi},
 	{"hostname", _hostname},
@@ -828,6 +1886,9 @@ tjost_lua_init(Tjost_Host *host, int argc, const char **argv)
 
 	luaL_openlibs(L);
 
+	// install watchdog hook for default limits
+	_watchdog_set(host);
+
 	// disable libs that are not rt safe.
 	//lua_pushnil(L);
 	//	lua_setglobal(L, "io"); //FIXME add function to get PID instead
@@ -887,6 +1948,18 @@ tjost_lua_init(Tjost_Host *host, int argc, const char **argv)
 	luaL_register(L, NULL, tjost_midi_mt);
 	lua_pop(L, 1); // mt
 
+	luaL_newmetatable(L, "Tjost_View"); // mt
+	luaL_register(L, NULL, tjost_view_mt);
+	lua_pop(L, 1); // mt
+
+	// pool of reusable views
+	lua_newtable(L);
+	host->views.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	luaL_newmetatable(L, "Tjost_Batch"); // mt
+	luaL_register(L, NULL, tjost_batch_mt);
+	lua_pop(L, 1); // mt
+
 	lua_getglobal(L, "package");
 	lua_getfield(L, -1, "cpath");
 	lua_pushstring(L, ";/usr/local/lib/tjost/lua/?.so"); //FIXME
@@ -931,4 +2004,8 @@ tjost_lua_deregister(Tjost_Host *host)
 	lua_getglobal(L, "tjost");
 	lua_pushnil(L);
 		lua_setfield(L, -2, "plugin");
+	lua_pushnil(L);
+		lua_setfield(L, -2, "heap");
+	lua_pushnil(L);
+		lua_setfield(L, -2, "reserve");
 }
@@ -17,6 +17,25 @@
 
 #include <tjost.h>
 
+#include <unistd.h>
+
+// records never wrap around the end of the ring, the rest of the ring is skipped instead,
+// explicitly with a padding header or implicitly if even a header does not fit
+#define TJOST_PIPE_PAD (0xffff)
+#define TJOST_PIPE_ALIGN(LEN) (((LEN) + 7) & ~7)
+
+// 32-bit FNV-1a
+#define TJOST_PIPE_HASH_INIT (0x811c9dc5)
+#define TJOST_PIPE_HASH_PRIME (0x01000193)
+
+// stands in for TJOST_MODULE_BROADCAST in source tables, where NULL marks a free entry
+static const char _tjost_pipe_broadcast;
+#define TJOST_PIPE_BROADCAST ((Tjost_Module *)&_tjost_pipe_broadcast)
+
+// marks entries of deleted modules, freed again once the pipe has drained
+static const char _tjost_pipe_retired;
+#define TJOST_PIPE_RETIRED ((Tjost_Module *)&_tjost_pipe_retired)
+
 static void
 _asio(uv_async_t *handle)
 {
@@ -25,19 +44,67 @@ _asio(uv_async_t *handle)
 	tjost_pipe_consume(pipe, pipe->alloc_cb, pipe->sched_cb, pipe->arg);
 }
 
+// producer counters have a single writer unless the pipe is multi-producer, readers may be on any thread
+static inline void
+_tjost_pipe_count(Tjost_Pipe *pipe, size_t *counter, size_t n)
+{
+	if(pipe->mpsc)
+		__atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+	else
+		__atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+static inline void
+_tjost_pipe_high(Tjost_Pipe *pipe)
+{
+	size_t fill = tjost_pipe_fill(pipe);
+	size_t high = __atomic_load_n(&pipe->stats.high, __ATOMIC_RELAXED);
+
+	while( (fill > high)
+		&& !__atomic_compare_exchange_n(&pipe->stats.high, &high, fill, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+		;
+}
+
 int
-tjost_pipe_init(Tjost_Pipe *pipe)
+tjost_pipe_init(Tjost_Pipe *pipe, Tjost_Module *module)
 {
-	// init jack ringbuffer
-	if(!(pipe->rb = jack_ringbuffer_create(TJOST_RINGBUF_SIZE)))
+	size_t size = module && module->pipe_size ? module->pipe_size : TJOST_RINGBUF_SIZE;
+
+	memset(pipe, 0, sizeof(Tjost_Pipe));
+
+	pipe->module = module;
+	pipe->policy = module ? module->pipe_policy : TJOST_PIPE_DROP_NEWEST;
+
+	if(module)
+		module->pipes = eina_inlist_append(module->pipes, EINA_INLIST_GET(pipe));
+
+	// init jack ringbuffer, capacity is rounded up to a power of two
+	if(!(pipe->rb = jack_ringbuffer_create(size)))
 		return -1;
 
 	return 0;
 }
 
+// pipe fed by multiple threads, only tjost_pipe_produce may be used on it
+int
+tjost_pipe_init_mpsc(Tjost_Pipe *pipe, Tjost_Module *module)
+{
+	if(tjost_pipe_init(pipe, module))
+		return -1;
+
+	// unpublished headers must read as zero
+	memset(pipe->rb->buf, 0, pipe->rb->size);
+	pipe->mpsc = 1;
+
+	return 0;
+}
+
 int 
 tjost_pipe_deinit(Tjost_Pipe *pipe)
 {
+	if(pipe->module)
+		pipe->module->pipes = eina_inlist_remove(pipe->module->pipes, EINA_INLIST_GET(pipe));
+
 	// deinit jack ringbuffer
 	if(pipe->rb)
 		jack_ringbuffer_free(pipe->rb);
@@ -45,65 +112,483 @@ tjost_pipe_deinit(Tjost_Pipe *pipe)
 	return 0;
 }
 
+size_t
+tjost_pipe_fill(Tjost_Pipe *pipe)
+{
+	if(pipe->mpsc)
+		return __atomic_load_n(&pipe->tx_pos, __ATOMIC_RELAXED) - __atomic_load_n(&pipe->rx_pos, __ATOMIC_RELAXED);
+
+	return jack_ringbuffer_read_space(pipe->rb);
+}
+
 size_t
 tjost_pipe_space(Tjost_Pipe *pipe)
 {
+	if(pipe->mpsc)
+		return pipe->rb->size - tjost_pipe_fill(pipe);
+
 	return jack_ringbuffer_write_space(pipe->rb);
 }
 
+static osc_data_t *
+_tjost_pipe_slot(Tjost_Pipe *pipe, size_t size)
+{
+	jack_ringbuffer_data_t vec [2];
+
+	jack_ringbuffer_get_write_vector(pipe->rb, vec);
+
+	if(vec[0].len >= size)
+	{
+		pipe->pad = 0;
+		pipe->slot = (Tjost_Pipe_Record *)vec[0].buf;
+	}
+	else if(vec[1].len >= size) // vec[0] reaches up to the end of the ring
+	{
+		pipe->pad = vec[0].len;
+		pipe->slot = (Tjost_Pipe_Record *)vec[1].buf;
+
+		if(pipe->pad >= sizeof(Tjost_Pipe_Record))
+		{
+			Tjost_Pipe_Record *pad = (Tjost_Pipe_Record *)vec[0].buf;
+			pad->size = pipe->pad - sizeof(Tjost_Pipe_Record);
+			pad->source = TJOST_PIPE_PAD;
+		}
+	}
+	else
+		return NULL;
+
+	return pipe->slot->buf;
+}
+
+// producer, hand out a contiguous slot for a payload of up to len bytes, single producer only
+osc_data_t *
+tjost_pipe_reserve(Tjost_Pipe *pipe, size_t len)
+{
+	size_t size = TJOST_PIPE_ALIGN(sizeof(Tjost_Pipe_Record) + len);
+	osc_data_t *buf = NULL;
+	unsigned int ms;
+
+	if(!pipe->mpsc && (len <= UINT16_MAX))
+	{
+		if(!(buf = _tjost_pipe_slot(pipe, size)) && (pipe->policy == TJOST_PIPE_BLOCK))
+		{
+			// poll for the real time consumer, which drains once a period
+			for(ms=0; !buf && (ms<TJOST_PIPE_BLOCK_MAX); ms++)
+			{
+				usleep(1000);
+				buf = _tjost_pipe_slot(pipe, size);
+			}
+		}
+
+		// let consumer discard everything queued up to here
+		if(!buf && (pipe->policy == TJOST_PIPE_DROP_OLDEST))
+			__atomic_store_n(&pipe->trim, pipe->tx_pos, __ATOMIC_RELEASE);
+	}
+
+	if(!buf)
+		_tjost_pipe_count(pipe, &pipe->stats.dropped, 1);
+
+	return buf;
+}
+
+// producer, most pipes only ever see one or two distinct source modules,
+// index 0 is never handed out, it marks unpublished records
+static inline int
+_tjost_pipe_source(Tjost_Pipe *pipe, Tjost_Module *module)
+{
+	unsigned int i;
+
+	if(module == TJOST_MODULE_BROADCAST)
+		module = TJOST_PIPE_BROADCAST;
+
+	for(i=1; i<TJOST_PIPE_SOURCES; i++)
+	{
+		Tjost_Module *source = __atomic_load_n(&pipe->sources[i], __ATOMIC_ACQUIRE);
+
+		if(!source && __atomic_compare_exchange_n(&pipe->sources[i], &source, module, 0,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			return i;
+
+		if(source == module) // possibly added by a concurrent producer
+			return i;
+	}
+
+	return -1;
+}
+
+// consumer
+static inline Tjost_Module *
+_tjost_pipe_module(Tjost_Pipe *pipe, Tjost_Pipe_Record *rec)
+{
+	Tjost_Module *module = pipe->sources[rec->source];
+
+	return module == TJOST_PIPE_BROADCAST ? TJOST_MODULE_BROADCAST : module;
+}
+
+// consumer, free retired entries when no record can reference them anymore
+static inline void
+_tjost_pipe_recycle(Tjost_Pipe *pipe)
+{
+	unsigned int i;
+
+	if(tjost_pipe_fill(pipe) || !__atomic_exchange_n(&pipe->retired, 0, __ATOMIC_ACQ_REL))
+		return;
+
+	for(i=1; i<TJOST_PIPE_SOURCES; i++)
+	{
+		Tjost_Module *source = TJOST_PIPE_RETIRED;
+
+		__atomic_compare_exchange_n(&pipe->sources[i], &source, NULL, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+	}
+}
+
+// any thread, after the module has stopped producing into the pipe,
+// its pending records get discarded and its entry does not outlive it
+void
+tjost_pipe_forget(Tjost_Pipe *pipe, Tjost_Module *module)
+{
+	unsigned int i;
+
+	for(i=1; i<TJOST_PIPE_SOURCES; i++)
+	{
+		Tjost_Module *source = module;
+
+		if(__atomic_compare_exchange_n(&pipe->sources[i], &source, TJOST_PIPE_RETIRED, 0,
+				__ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			__atomic_store_n(&pipe->retired, 1, __ATOMIC_RELEASE);
+	}
+}
+
+// producer, publish the last reserved slot with the actually written payload size
 int
-tjost_pipe_produce(Tjost_Pipe *pipe, Tjost_Module *module, jack_nframes_t timestamp, size_t len, osc_data_t *buf)
+tjost_pipe_commit(Tjost_Pipe *pipe, Tjost_Module *module, jack_nframes_t timestamp, size_t len)
 {
-	Tjost_Event tev;
-	tev.module = module,
-	tev.time = timestamp;
-	tev.size = len;
+	Tjost_Pipe_Record *rec = pipe->slot;
+	size_t size = pipe->pad + TJOST_PIPE_ALIGN(sizeof(Tjost_Pipe_Record) + len);
+	int source;
 
-	if(jack_ringbuffer_write_space(pipe->rb) < sizeof(Tjost_Event) + tev.size)
+	if((source = _tjost_pipe_source(pipe, module)) < 0)
+	{
+		_tjost_pipe_count(pipe, &pipe->stats.dropped, 1);
 		return -1;
-	else
+	}
+
+	rec->time = timestamp;
+	rec->size = len;
+	rec->source = source;
+
+	jack_ringbuffer_write_advance(pipe->rb, size);
+	pipe->tx_pos += size;
+
+	_tjost_pipe_high(pipe);
+	_tjost_pipe_count(pipe, &pipe->stats.produced, 1);
+	_tjost_pipe_count(pipe, &pipe->stats.bytes, len);
+
+	return 0;
+}
+
+// producers claim space by moving the shared write position forward and publish
+// their record by setting its source index last, the consumer stops at the first
+// unpublished record and zeroes what it has consumed before handing it back
+static int
+_tjost_pipe_produce_mpsc(Tjost_Pipe *pipe, Tjost_Module *module, jack_nframes_t timestamp, size_t len, osc_data_t *buf)
+{
+	jack_ringbuffer_t *rb = pipe->rb;
+	size_t size = TJOST_PIPE_ALIGN(sizeof(Tjost_Pipe_Record) + len);
+	size_t pos = __atomic_load_n(&pipe->tx_pos, __ATOMIC_RELAXED);
+	size_t pad;
+	unsigned int ms = 0;
+	int source;
+
+	if( (len > UINT16_MAX) || ((source = _tjost_pipe_source(pipe, module)) < 0) )
 	{
-		if(jack_ringbuffer_write(pipe->rb, (const char *)&tev, sizeof(Tjost_Event)) != sizeof(Tjost_Event))
-			return -1;
-		if(jack_ringbuffer_write(pipe->rb, (const char *)buf, tev.size) != tev.size)
+		_tjost_pipe_count(pipe, &pipe->stats.dropped, 1);
+		return -1;
+	}
+
+	while(1)
+	{
+		size_t tail = rb->size - (pos & rb->size_mask);
+		size_t rx_pos = __atomic_load_n(&pipe->rx_pos, __ATOMIC_ACQUIRE);
+
+		pad = tail < size ? tail : 0;
+
+		if(pos + pad + size - rx_pos > rb->size) // full
+		{
+			if( (pipe->policy == TJOST_PIPE_BLOCK) && (ms++ < TJOST_PIPE_BLOCK_MAX) )
+			{
+				usleep(1000);
+				pos = __atomic_load_n(&pipe->tx_pos, __ATOMIC_RELAXED);
+				continue;
+			}
+
+			// let consumer discard everything claimed up to here
+			if(pipe->policy == TJOST_PIPE_DROP_OLDEST)
+				__atomic_store_n(&pipe->trim, pos, __ATOMIC_RELEASE);
+
+			_tjost_pipe_count(pipe, &pipe->stats.dropped, 1);
 			return -1;
+		}
+
+		if(__atomic_compare_exchange_n(&pipe->tx_pos, &pos, pos + pad + size, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+
+	if(pad >= sizeof(Tjost_Pipe_Record))
+	{
+		Tjost_Pipe_Record *rec = (Tjost_Pipe_Record *)(rb->buf + (pos & rb->size_mask));
+		rec->size = pad - sizeof(Tjost_Pipe_Record);
+		__atomic_store_n(&rec->source, TJOST_PIPE_PAD, __ATOMIC_RELEASE);
 	}
 
+	Tjost_Pipe_Record *rec = (Tjost_Pipe_Record *)(rb->buf + ((pos + pad) & rb->size_mask));
+	rec->time = timestamp;
+	rec->size = len;
+	memcpy(rec->buf, buf, len);
+	__atomic_store_n(&rec->source, source, __ATOMIC_RELEASE);
+
+	_tjost_pipe_high(pipe);
+	_tjost_pipe_count(pipe, &pipe->stats.produced, 1);
+	_tjost_pipe_count(pipe, &pipe->stats.bytes, len);
+
 	return 0;
 }
 
 int
-tjost_pipe_flush(Tjost_Pipe *pipe)
+tjost_pipe_produce(Tjost_Pipe *pipe, Tjost_Module *module, jack_nframes_t timestamp, size_t len, osc_data_t *buf)
 {
-	if(uv_async_send(&pipe->asio))
+	osc_data_t *dst;
+
+	if(pipe->mpsc)
+		return _tjost_pipe_produce_mpsc(pipe, module, timestamp, len, buf);
+
+	if(!(dst = tjost_pipe_reserve(pipe, len)))
 		return -1;
 
-	return 0;
+	memcpy(dst, buf, len);
+
+	return tjost_pipe_commit(pipe, module, timestamp, len);
+}
+
+// consumer, record at position pos, or NULL with the bytes of padding to skip,
+// or NULL and 0 if nothing (published) is pending
+static inline Tjost_Pipe_Record *
+_tjost_pipe_at(Tjost_Pipe *pipe, size_t pos, size_t *skip)
+{
+	jack_ringbuffer_t *rb = pipe->rb;
+	size_t tail = rb->size - (pos & rb->size_mask);
+	size_t pending = pipe->mpsc
+		? __atomic_load_n(&pipe->tx_pos, __ATOMIC_ACQUIRE) - pos
+		: jack_ringbuffer_read_space(rb) - (pos - pipe->rx_pos);
+
+	*skip = 0;
+
+	if(!pending)
+		return NULL;
+
+	if(tail < sizeof(Tjost_Pipe_Record)) // implicit padding
+	{
+		*skip = tail;
+		return NULL;
+	}
+
+	Tjost_Pipe_Record *rec = (Tjost_Pipe_Record *)(rb->buf + (pos & rb->size_mask));
+	uint16_t source = __atomic_load_n(&rec->source, __ATOMIC_ACQUIRE);
+
+	if(!source) // claimed but not yet published
+		return NULL;
+
+	if(source == TJOST_PIPE_PAD)
+	{
+		*skip = sizeof(Tjost_Pipe_Record) + rec->size;
+		return NULL;
+	}
+
+	return rec;
+}
+
+static inline void
+_tjost_pipe_advance(Tjost_Pipe *pipe, size_t size)
+{
+	jack_ringbuffer_t *rb = pipe->rb;
+
+	if(pipe->mpsc)
+	{
+		memset(rb->buf + (pipe->rx_pos & rb->size_mask), 0, size);
+		__atomic_store_n(&pipe->rx_pos, pipe->rx_pos + size, __ATOMIC_RELEASE);
+	}
+	else
+	{
+		jack_ringbuffer_read_advance(rb, size);
+		pipe->rx_pos += size;
+	}
+}
+
+static inline uint32_t
+_tjost_pipe_hash(const char *path)
+{
+	uint32_t hash = TJOST_PIPE_HASH_INIT;
+
+	for( ; *path; path++)
+		hash = (hash ^ (uint8_t)*path) * TJOST_PIPE_HASH_PRIME;
+
+	return hash;
 }
 
+// find slot of path in table of latest messages, NULL if table is full
+static Tjost_Pipe_Latest *
+_tjost_pipe_latest(Tjost_Pipe *pipe, Tjost_Pipe_Record *rec)
+{
+	uint32_t hash = _tjost_pipe_hash((const char *)rec->buf);
+	unsigned int idx = hash & (TJOST_PIPE_LATEST - 1);
+	unsigned int i;
+
+	for(i=0; i<TJOST_PIPE_LATEST; i++)
+	{
+		Tjost_Pipe_Latest *latest = &pipe->latest[idx];
+
+		if(!latest->rec)
+		{
+			latest->hash = hash;
+			return latest;
+		}
+
+		if( (latest->hash == hash) && ((ssize_t)(latest->pos - pipe->rx_pos) >= 0)
+				&& !strcmp((const char *)latest->rec->buf, (const char *)rec->buf) )
+			return latest;
+
+		idx = (idx + 1) & (TJOST_PIPE_LATEST - 1);
+	}
+
+	return NULL;
+}
+
+// consumer, walk all pending records and remember the latest message per path
+static void
+_tjost_pipe_latest_scan(Tjost_Pipe *pipe)
+{
+	size_t pos = pipe->rx_pos;
+
+	memset(pipe->latest, 0, sizeof(pipe->latest));
+
+	while(1)
+	{
+		Tjost_Pipe_Latest *latest;
+		size_t skip;
+		Tjost_Pipe_Record *rec = _tjost_pipe_at(pipe, pos, &skip);
+
+		if(rec)
+		{
+			if( (rec->buf[0] == '/') && (latest = _tjost_pipe_latest(pipe, rec)) )
+			{
+				latest->rec = rec;
+				latest->pos = pos;
+			}
+
+			skip = TJOST_PIPE_ALIGN(sizeof(Tjost_Pipe_Record) + rec->size);
+		}
+		else if(!skip)
+			break;
+
+		pos += skip;
+	}
+
+	pipe->latest_end = pos;
+}
+
+// consumer, is there a later pending message with the same path?
+static int
+_tjost_pipe_superseded(Tjost_Pipe *pipe, Tjost_Pipe_Record *rec)
+{
+	Tjost_Pipe_Latest *latest;
+
+	if((ssize_t)(pipe->latest_end - pipe->rx_pos) <= 0) // previous pass is done
+		_tjost_pipe_latest_scan(pipe);
+
+	if( (rec->buf[0] != '/') || !(latest = _tjost_pipe_latest(pipe, rec)) || !latest->rec )
+		return 0;
+
+	return latest->rec != rec;
+}
+
+// consumer, next record in place, valid until released
+Tjost_Pipe_Record *
+tjost_pipe_peek(Tjost_Pipe *pipe)
+{
+	size_t trim = __atomic_load_n(&pipe->trim, __ATOMIC_ACQUIRE);
+
+	while(1)
+	{
+		size_t skip;
+		Tjost_Pipe_Record *rec = _tjost_pipe_at(pipe, pipe->rx_pos, &skip);
+
+		if(!rec)
+		{
+			if(!skip) // empty
+			{
+				_tjost_pipe_recycle(pipe);
+				return NULL;
+			}
+
+			_tjost_pipe_advance(pipe, skip); // padding
+			continue;
+		}
+
+		if( ((ssize_t)(trim - pipe->rx_pos) > 0) // queued before an overflow
+			|| (__atomic_load_n(&pipe->sources[rec->source], __ATOMIC_ACQUIRE) == TJOST_PIPE_RETIRED) // source is gone
+			|| ((pipe->policy == TJOST_PIPE_COALESCE) && _tjost_pipe_superseded(pipe, rec)) )
+		{
+			_tjost_pipe_count(pipe, &pipe->stats.discarded, 1);
+			tjost_pipe_release(pipe, rec);
+			continue;
+		}
+
+		return rec;
+	}
+}
+
+void
+tjost_pipe_release(Tjost_Pipe *pipe, Tjost_Pipe_Record *rec)
+{
+	_tjost_pipe_advance(pipe, TJOST_PIPE_ALIGN(sizeof(Tjost_Pipe_Record) + rec->size));
+}
+
+// real time, consumer is signalled at end of period, see tjost_wakeup.c
+void
+tjost_pipe_flush(Tjost_Pipe *pipe, Tjost_Module *module)
+{
+	tjost_host_wakeup(module->host, &pipe->wake, module);
+}
+
+// without alloc_cb, sched_cb gets the payload in place in the ring, valid during the call only
 int
 tjost_pipe_consume(Tjost_Pipe *pipe, Tjost_Pipe_Alloc_Cb alloc_cb, Tjost_Pipe_Sched_Cb sched_cb, void *arg)
 {
+	Tjost_Pipe_Record *rec;
 	Tjost_Event tev;
 
-	while(jack_ringbuffer_read_space(pipe->rb) >= sizeof(Tjost_Event))
+	while((rec = tjost_pipe_peek(pipe)))
 	{
-		if(jack_ringbuffer_peek(pipe->rb, (char *)&tev, sizeof(Tjost_Event)) != sizeof(Tjost_Event))
-			return -1;
+		// expand wire header for the callbacks
+		tev.module = _tjost_pipe_module(pipe, rec);
+		tev.ref = 0;
+		tev.time = rec->time;
+		tev.size = rec->size;
 
-		if(jack_ringbuffer_read_space(pipe->rb) >= sizeof(Tjost_Event) + tev.size)
-		{
-			jack_ringbuffer_read_advance(pipe->rb, sizeof(Tjost_Event));
+		osc_data_t *buffer = rec->buf;
 
-			osc_data_t *buffer = alloc_cb(&tev, arg);
-			//FIXME check return
+		if(alloc_cb && (buffer = alloc_cb(&tev, arg))) // copy out of the ring
+			memcpy(buffer, rec->buf, tev.size);
 
-			if(jack_ringbuffer_read(pipe->rb, (char *)buffer, tev.size) != tev.size)
-				return -1;
+		// skip event if there is no space for it
+		int stop = buffer ? sched_cb(&tev, buffer, arg) : 0;
 
-			if(sched_cb(&tev, buffer, arg))
-				break;
-		}
+		tjost_pipe_release(pipe, rec);
+
+		if(stop)
+			break;
 	}
 
 	return 0;
@@ -116,8 +601,13 @@ tjost_pipe_listen_start(Tjost_Pipe *pipe, uv_loop_t *loop, Tjost_Pipe_Alloc_Cb a
 	pipe->sched_cb = sched_cb;
 	pipe->arg = arg;
 
+	// producer is the real time thread, it must not block
+	if(pipe->policy == TJOST_PIPE_BLOCK)
+		pipe->policy = TJOST_PIPE_DROP_NEWEST;
+
 	// init uv asynchronous signal
 	pipe->asio.data = pipe;
+	tjost_wakeup_init(&pipe->wake, &pipe->asio, pipe->rb);
 	int err;
 	if((err = uv_async_init(loop, &pipe->asio, _asio)))
 		fprintf(stderr, "tjost_pipe_listen_start: %s\n", uv_err_name(err));
@@ -129,6 +619,7 @@ int
 tjost_pipe_listen_stop(Tjost_Pipe *pipe)
 {
 	// deinit uv asynchronous signal
+	tjost_host_wakeup_cancel(&pipe->wake);
 	uv_close((uv_handle_t *)&pipe->asio, NULL);
 
 	return 0;
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2015 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <tjost.h>
+
+#define TJOST_QUEUE_MASK (TJOST_QUEUE_SLOTS - 1)
+#define TJOST_QUEUE_WIDTH(QUEUE) ((jack_nframes_t)1 << (QUEUE)->shift)
+#define TJOST_QUEUE_SPAN(QUEUE) ((jack_nframes_t)TJOST_QUEUE_SLOTS << (QUEUE)->shift)
+
+static inline Eina_Inlist **
+_tjost_queue_slot(Tjost_Queue *queue, jack_nframes_t time)
+{
+	return &queue->slots[(time >> queue->shift) & TJOST_QUEUE_MASK];
+}
+
+// insert after the last event with an equal or earlier timestamp, as events
+// mostly arrive in order, this is O(1) in the common case and keeps
+// insertion order for equal timestamps
+static Eina_Inlist *
+_tjost_queue_sorted_append(Eina_Inlist *list, Tjost_Event *tev)
+{
+	Eina_Inlist *l;
+
+	for(l = list ? list->last : NULL; l; l = l->prev)
+	{
+		Tjost_Event *ev = EINA_INLIST_CONTAINER_GET(l, Tjost_Event);
+
+		if(ev->time <= tev->time)
+			return eina_inlist_append_relative(list, EINA_INLIST_GET(tev), l);
+	}
+
+	return eina_inlist_prepend(list, EINA_INLIST_GET(tev));
+}
+
+static inline void
+_tjost_queue_wheel_insert(Tjost_Queue *queue, Tjost_Event *tev)
+{
+	// late and immediate events go to the current slot
+	jack_nframes_t time = tev->time < queue->cursor ? queue->cursor : tev->time;
+	Eina_Inlist **slot = _tjost_queue_slot(queue, time);
+
+	*slot = _tjost_queue_sorted_append(*slot, tev);
+	queue->count++;
+}
+
+// move far-future events that came into reach of the wheel
+static void
+_tjost_queue_migrate(Tjost_Queue *queue)
+{
+	jack_nframes_t end = queue->cursor + TJOST_QUEUE_SPAN(queue);
+
+	while(queue->overflow)
+	{
+		Tjost_Event *tev = EINA_INLIST_CONTAINER_GET(queue->overflow, Tjost_Event);
+
+		if(tev->time >= end)
+			break;
+
+		queue->overflow = eina_inlist_remove(queue->overflow, EINA_INLIST_GET(tev));
+		_tjost_queue_wheel_insert(queue, tev);
+	}
+}
+
+void
+tjost_queue_init(Tjost_Queue *queue, jack_nframes_t period)
+{
+	memset(queue, 0, sizeof(Tjost_Queue));
+
+	// slot width is the period size rounded up to the next power of two
+	while(TJOST_QUEUE_WIDTH(queue) < period)
+		queue->shift++;
+}
+
+void
+tjost_queue_insert(Tjost_Queue *queue, Tjost_Event *tev)
+{
+	if(tev->time == 0) // immediate execution, keep arrival order
+		queue->immediate = eina_inlist_append(queue->immediate, EINA_INLIST_GET(tev));
+	else if(tev->time >= queue->cursor + TJOST_QUEUE_SPAN(queue))
+		queue->overflow = _tjost_queue_sorted_append(queue->overflow, tev);
+	else
+		_tjost_queue_wheel_insert(queue, tev);
+}
+
+Tjost_Event *
+tjost_queue_pop(Tjost_Queue *queue, jack_nframes_t horizon)
+{
+	// immediate events go ahead of timestamped ones
+	if(queue->immediate)
+	{
+		Tjost_Event *tev = EINA_INLIST_CONTAINER_GET(queue->immediate, Tjost_Event);
+		queue->immediate = eina_inlist_remove(queue->immediate, EINA_INLIST_GET(tev));
+
+		return tev;
+	}
+
+	while(1)
+	{
+		if(queue->count == 0)
+		{
+			// nothing on the wheel, jump directly to the horizon or to the next far-future event
+			jack_nframes_t time = horizon;
+
+			if(queue->overflow)
+			{
+				Tjost_Event *tev = EINA_INLIST_CONTAINER_GET(queue->overflow, Tjost_Event);
+				if(tev->time < time)
+					time = tev->time;
+			}
+
+			time &= ~(TJOST_QUEUE_WIDTH(queue) - 1);
+			if(time > queue->cursor)
+				queue->cursor = time;
+
+			_tjost_queue_migrate(queue);
+
+			if(queue->count == 0)
+				return NULL;
+		}
+
+		Eina_Inlist **slot = _tjost_queue_slot(queue, queue->cursor);
+
+		if(*slot)
+		{
+			Tjost_Event *tev = EINA_INLIST_CONTAINER_GET(*slot, Tjost_Event);
+
+			if(tev->time >= horizon)
+				return NULL;
+
+			*slot = eina_inlist_remove(*slot, EINA_INLIST_GET(tev));
+			queue->count--;
+
+			return tev;
+		}
+
+		// current slot is drained, advance if it lies completely before the horizon
+		if(queue->cursor + TJOST_QUEUE_WIDTH(queue) > horizon)
+			return NULL;
+
+		queue->cursor += TJOST_QUEUE_WIDTH(queue);
+		_tjost_queue_migrate(queue);
+	}
+}
+
+void
+tjost_queue_clear(Tjost_Queue *queue, Tjost_Host *host)
+{
+	Eina_Inlist *l;
+	Tjost_Event *tev;
+	unsigned int i;
+
+	for(i=0; i<TJOST_QUEUE_SLOTS; i++)
+		EINA_INLIST_FOREACH_SAFE(queue->slots[i], l, tev)
+		{
+			queue->slots[i] = eina_inlist_remove(queue->slots[i], EINA_INLIST_GET(tev));
+			tjost_event_free(host, tev);
+		}
+
+	EINA_INLIST_FOREACH_SAFE(queue->overflow, l, tev)
+	{
+		queue->overflow = eina_inlist_remove(queue->overflow, EINA_INLIST_GET(tev));
+		tjost_event_free(host, tev);
+	}
+
+	EINA_INLIST_FOREACH_SAFE(queue->immediate, l, tev)
+	{
+		queue->immediate = eina_inlist_remove(queue->immediate, EINA_INLIST_GET(tev));
+		tjost_event_free(host, tev);
+	}
+
+	queue->count = 0;
+}
+
+static inline int
+_tjost_module_queue_owns(Tjost_Module_Queue *queue, Tjost_Event *tev)
+{
+	return ((osc_data_t *)tev >= queue->arena) && ((osc_data_t *)tev < queue->arena + queue->arena_size);
+}
+
+static inline void
+_tjost_module_queue_unref(Tjost_Module_Queue *queue, Tjost_Host *host, Tjost_Event *tev)
+{
+	if(!_tjost_module_queue_owns(queue, tev))
+		tjost_event_unref(host, tev);
+}
+
+// free the span consumed by the last drain in bulk, arena events are reclaimed as a whole
+static void
+_tjost_module_queue_release(Tjost_Module_Queue *queue, Tjost_Host *host)
+{
+	unsigned int i;
+
+	for(i=0; i<queue->head; i++)
+		_tjost_module_queue_unref(queue, host, queue->evs[i]);
+
+	if(queue->head == queue->tail)
+	{
+		queue->head = 0;
+		queue->tail = 0;
+		queue->arena_used = 0; // reset bump allocator
+	}
+	else if(queue->head > 0)
+	{
+		memmove(queue->evs, queue->evs + queue->head, (queue->tail - queue->head) * sizeof(Tjost_Event *));
+		queue->tail -= queue->head;
+		queue->head = 0;
+	}
+}
+
+Tjost_Event *
+tjost_module_queue_alloc(Tjost_Module *module, size_t len)
+{
+	Tjost_Module_Queue *queue = &module->queue;
+	Tjost_Host *host = module->host;
+	size_t size = (sizeof(Tjost_Event) + len + 7) & ~7; // keep 8-byte alignment
+
+	if(!queue->arena)
+	{
+		if((queue->arena = tjost_heap_alloc(host, TJOST_HEAP_EVENT, TJOST_MODULE_ARENA_SIZE)))
+			queue->arena_size = TJOST_MODULE_ARENA_SIZE;
+	}
+
+	if(queue->arena_used + size <= queue->arena_size)
+	{
+		Tjost_Event *tev = (Tjost_Event *)(queue->arena + queue->arena_used);
+		queue->arena_used += size;
+		return tev;
+	}
+
+	// arena exhausted by pending events, fall back to the event slabs
+	return tjost_event_alloc(host, len);
+}
+
+void
+tjost_module_queue_push(Tjost_Module *module, Tjost_Event *tev)
+{
+	Tjost_Module_Queue *queue = &module->queue;
+	Tjost_Host *host = module->host;
+
+	if(queue->tail == queue->size)
+	{
+		unsigned int size = queue->size ? queue->size * 2 : TJOST_MODULE_QUEUE_SIZE;
+		Tjost_Event **evs = queue->evs
+			? tjost_heap_realloc(host, TJOST_HEAP_EVENT, size * sizeof(Tjost_Event *), queue->evs)
+			: tjost_heap_alloc(host, TJOST_HEAP_EVENT, size * sizeof(Tjost_Event *));
+
+		if(!evs)
+		{
+			if(tev->module == module)
+				tjost_quota_release(module, tev->size);
+			_tjost_module_queue_unref(queue, host, tev);
+			return;
+		}
+
+		queue->evs = evs;
+		queue->size = size;
+	}
+
+	// find insertion point from the back, keeps order of equal timestamps
+	unsigned int i = queue->tail;
+	while( (i > queue->head) && (queue->evs[i-1]->time > tev->time) )
+		i--;
+
+	if(i < queue->tail)
+		memmove(&queue->evs[i+1], &queue->evs[i], (queue->tail - i) * sizeof(Tjost_Event *));
+	queue->evs[i] = tev;
+	queue->tail++;
+}
+
+Tjost_Event *
+tjost_module_drain(Tjost_Module *module, jack_nframes_t last, jack_nframes_t nframes, jack_nframes_t *time)
+{
+	Tjost_Module_Queue *queue = &module->queue;
+	Tjost_Host *host = module->host;
+
+	if(queue->head < queue->tail)
+	{
+		Tjost_Event *tev = queue->evs[queue->head];
+
+		if(tev->time < last + nframes)
+		{
+			if(tev->module == module) // scheduled by the module itself
+				tjost_quota_release(module, tev->size);
+
+			// event may be shared with other modules, hand out due time separately
+			*time = tev->time;
+			if(tev->time == 0) // immediate execution
+				*time = last;
+			else if(tev->time < last)
+			{
+				tjost_host_message_push(host, "module queue: late event %i in %s", tev->time - last, module->name);
+				*time = last;
+			}
+
+			queue->head++;
+			return tev;
+		}
+	}
+
+	_tjost_module_queue_release(queue, host);
+
+	return NULL;
+}
+
+unsigned int
+tjost_module_queue_count(Tjost_Module *module)
+{
+	Tjost_Module_Queue *queue = &module->queue;
+
+	return queue->tail - queue->head;
+}
+
+void
+tjost_module_queue_clear(Tjost_Module *module)
+{
+	Tjost_Module_Queue *queue = &module->queue;
+	unsigned int i;
+
+	for(i=queue->head; i<queue->tail; i++)
+		if(queue->evs[i]->module == module)
+			tjost_quota_release(module, queue->evs[i]->size);
+
+	queue->head = queue->tail; // mark all events as consumed
+	_tjost_module_queue_release(queue, module->host);
+}
+
+void
+tjost_module_queue_deinit(Tjost_Module *module)
+{
+	Tjost_Module_Queue *queue = &module->queue;
+	Tjost_Host *host = module->host;
+
+	tjost_module_queue_clear(module);
+
+	if(queue->evs)
+		tjost_heap_free(host, TJOST_HEAP_EVENT, queue->evs);
+	if(queue->arena)
+		tjost_heap_free(host, TJOST_HEAP_EVENT, queue->arena);
+
+	memset(queue, 0, sizeof(Tjost_Module_Queue));
+}
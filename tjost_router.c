@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <tjost.h>
+
+// 32-bit FNV-1a
+#define TJOST_ROUTER_HASH_INIT (0x811c9dc5)
+#define TJOST_ROUTER_HASH_PRIME (0x01000193)
+
+static inline uint32_t
+_tjost_router_hash(uint32_t hash, char c)
+{
+	return (hash ^ (uint8_t)c) * TJOST_ROUTER_HASH_PRIME;
+}
+
+static Tjost_Module *
+_tjost_router_find(Tjost_Router *router, uint32_t hash, const char *path, size_t len)
+{
+	unsigned int idx = hash & router->mask;
+	Tjost_Route *route;
+
+	// linear probing, table is at most half full
+	for(route=&router->routes[idx]; route->path; route=&router->routes[idx])
+	{
+		if( (route->hash == hash) && (route->len == len) && !strncmp(route->path, path, len) )
+			return route->target;
+
+		idx = (idx + 1) & router->mask;
+	}
+
+	return NULL;
+}
+
+Tjost_Router *
+tjost_router_new(Tjost_Host *host, unsigned int count, size_t len)
+{
+	unsigned int size = 2;
+	while(size < count*2)
+		size <<= 1;
+
+	// route slots are followed by storage for the path strings
+	size_t total = sizeof(Tjost_Router) + size*sizeof(Tjost_Route) + len;
+	Tjost_Router *router = tjost_alloc(host, total);
+	if(!router)
+		return NULL;
+
+	memset(router, 0, total);
+	router->mask = size - 1;
+	router->strings = (char *)&router->routes[size];
+	router->ref = LUA_NOREF;
+
+	return router;
+}
+
+int
+tjost_router_add(Tjost_Router *router, const char *path, Tjost_Module *target)
+{
+	uint32_t hash = TJOST_ROUTER_HASH_INIT;
+	size_t len;
+
+	for(len=0; path[len]; len++)
+		hash = _tjost_router_hash(hash, path[len]);
+
+	if(_tjost_router_find(router, hash, path, len))
+		return -1; // duplicate
+
+	unsigned int idx = hash & router->mask;
+	while(router->routes[idx].path)
+		idx = (idx + 1) & router->mask;
+
+	Tjost_Route *route = &router->routes[idx];
+	route->hash = hash;
+	route->len = len;
+	route->path = strcpy(router->strings, path);
+	route->target = target;
+
+	router->strings += len + 1;
+	router->count++;
+
+	return 0;
+}
+
+// real time
+Tjost_Module *
+tjost_router_lookup(Tjost_Router *router, const char *path)
+{
+	uint32_t hashes [TJOST_ROUTER_DEPTH];
+	size_t lens [TJOST_ROUTER_DEPTH];
+	int n = 0;
+	uint32_t hash = TJOST_ROUTER_HASH_INIT;
+	const char *c;
+
+	// hash whole path and remember hashes of all parent prefixes on the way
+	for(c=path; *c; c++)
+	{
+		if( (*c == '/') && (c > path) && (n < TJOST_ROUTER_DEPTH) )
+		{
+			hashes[n] = hash;
+			lens[n] = c - path;
+			n++;
+		}
+		hash = _tjost_router_hash(hash, *c);
+	}
+
+	Tjost_Module *target;
+
+	// longest match wins
+	if((target = _tjost_router_find(router, hash, path, c - path)))
+		return target;
+
+	while(n--)
+		if((target = _tjost_router_find(router, hashes[n], path, lens[n])))
+			return target;
+
+	return NULL;
+}
+
+void
+tjost_router_free(Tjost_Host *host, Tjost_Router *router)
+{
+	tjost_free(host, router);
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <tjost.h>
+
+static inline Tjost_Module **
+_tjost_routing_targets(Tjost_Module *module, Tjost_Module **ptr)
+{
+	Tjost_Child *child;
+
+	module->targets = ptr;
+	module->ntargets = 0;
+
+	EINA_INLIST_FOREACH(module->children, child)
+	{
+		*ptr++ = child->module;
+		module->ntargets++;
+	}
+
+	return ptr;
+}
+
+// flatten module lists and child chains into one contiguous table
+void
+tjost_routing_compile(Tjost_Host *host)
+{
+	Tjost_Routing *routing = &host->routing;
+	Tjost_Module *module;
+	unsigned int ninputs = 0;
+	unsigned int noutputs = 0;
+	unsigned int nuplinks = 0;
+	unsigned int nchildren = 0;
+
+	EINA_INLIST_FOREACH(host->modules, module)
+	{
+		if(module->type & TJOST_MODULE_INPUT)
+			ninputs++;
+		if(module->type & TJOST_MODULE_OUTPUT)
+			noutputs++;
+		nchildren += eina_inlist_count(module->children);
+	}
+	EINA_INLIST_FOREACH(host->uplinks, module)
+	{
+		nuplinks++;
+		nchildren += eina_inlist_count(module->children);
+	}
+
+	size_t len = (ninputs + noutputs + nuplinks + nchildren) * sizeof(Tjost_Module *);
+	Tjost_Module **table = len ? tjost_alloc(host, len) : NULL;
+
+	if(routing->table)
+		tjost_free(host, routing->table);
+
+	if(len && !table)
+	{
+		// old table may reference removed modules, route nothing until a rebuild succeeds
+		memset(routing, 0, sizeof(Tjost_Routing));
+		routing->dirty = 1;
+		tjost_host_message_push(host, "routing: %s", "out of memory, nothing routed until rebuilt");
+
+		EINA_INLIST_FOREACH(host->modules, module)
+		{
+			module->targets = NULL;
+			module->ntargets = 0;
+		}
+		EINA_INLIST_FOREACH(host->uplinks, module)
+		{
+			module->targets = NULL;
+			module->ntargets = 0;
+		}
+
+		return;
+	}
+
+	routing->table = table;
+	routing->inputs = table;
+	routing->ninputs = ninputs;
+	routing->outputs = routing->inputs + ninputs;
+	routing->noutputs = noutputs;
+	routing->uplinks = routing->outputs + noutputs;
+	routing->nuplinks = nuplinks;
+
+	Tjost_Module **inputs = routing->inputs;
+	Tjost_Module **outputs = routing->outputs;
+	Tjost_Module **uplinks = routing->uplinks;
+	Tjost_Module **targets = routing->uplinks + nuplinks;
+
+	EINA_INLIST_FOREACH(host->modules, module)
+	{
+		if(module->type & TJOST_MODULE_INPUT)
+			*inputs++ = module;
+		if(module->type & TJOST_MODULE_OUTPUT)
+			*outputs++ = module;
+		targets = _tjost_routing_targets(module, targets);
+	}
+	EINA_INLIST_FOREACH(host->uplinks, module)
+	{
+		*uplinks++ = module;
+		targets = _tjost_routing_targets(module, targets);
+	}
+
+	routing->dirty = 0;
+}
+
+void
+tjost_routing_deinit(Tjost_Host *host)
+{
+	Tjost_Routing *routing = &host->routing;
+
+	if(routing->table)
+		tjost_free(host, routing->table);
+
+	memset(routing, 0, sizeof(Tjost_Routing));
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <tjost.h>
+
+// pages are linked for teardown, objects start after the link
+#define TJOST_SLAB_PAGE_HEADER (16)
+
+static inline int
+_tjost_slab_class(size_t size)
+{
+	int i;
+
+	for(i=0; i<TJOST_SLAB_CLASSES; i++)
+		if(size <= (TJOST_SLAB_MIN << i))
+			return i;
+
+	return -1; // too big for slabs
+}
+
+// carve a new page from the event heap into objects of given class
+static int
+_tjost_slab_grow(Tjost_Host *host, Tjost_Slab_Class *klass)
+{
+	Tjost_Slab *slab = &host->slab;
+	osc_data_t *page = tjost_heap_alloc(host, TJOST_HEAP_EVENT, TJOST_SLAB_PAGE_SIZE);
+
+	if(!page)
+		return -1;
+
+	*(void **)page = slab->pages;
+	slab->pages = page;
+	klass->pages++;
+
+	osc_data_t *ptr;
+	osc_data_t *end = page + TJOST_SLAB_PAGE_SIZE - klass->size;
+	for(ptr = page + TJOST_SLAB_PAGE_HEADER; ptr <= end; ptr += klass->size)
+	{
+		*(void **)ptr = klass->free;
+		klass->free = ptr;
+		klass->avail++;
+	}
+
+	return 0;
+}
+
+void
+tjost_slab_init(Tjost_Slab *slab)
+{
+	int i;
+
+	memset(slab, 0, sizeof(Tjost_Slab));
+	for(i=0; i<TJOST_SLAB_CLASSES; i++)
+		slab->classes[i].size = TJOST_SLAB_MIN << i;
+}
+
+void
+tjost_slab_deinit(Tjost_Host *host)
+{
+	Tjost_Slab *slab = &host->slab;
+
+	while(slab->pages)
+	{
+		void *page = slab->pages;
+		slab->pages = *(void **)page;
+		tjost_heap_free(host, TJOST_HEAP_EVENT, page);
+	}
+
+	tjost_slab_init(slab);
+}
+
+// events are allocated by size class, the class is recovered from tev->size on free,
+// thus tev->size must be set to len and never changed afterwards
+Tjost_Event *
+tjost_event_alloc(Tjost_Host *host, size_t len)
+{
+	Tjost_Slab *slab = &host->slab;
+	int i = _tjost_slab_class(sizeof(Tjost_Event) + len);
+
+	if(i < 0)
+	{
+		slab->large++;
+		return tjost_heap_alloc(host, TJOST_HEAP_EVENT, sizeof(Tjost_Event) + len);
+	}
+
+	Tjost_Slab_Class *klass = &slab->classes[i];
+
+	if(!klass->free && _tjost_slab_grow(host, klass))
+		return NULL;
+
+	void *obj = klass->free;
+	klass->free = *(void **)obj;
+	klass->avail--;
+	klass->used++;
+
+	return obj;
+}
+
+void
+tjost_event_free(Tjost_Host *host, Tjost_Event *tev)
+{
+	Tjost_Slab *slab = &host->slab;
+	int i = _tjost_slab_class(sizeof(Tjost_Event) + tev->size);
+
+	if(i < 0)
+	{
+		slab->large--;
+		tjost_heap_free(host, TJOST_HEAP_EVENT, tev);
+		return;
+	}
+
+	Tjost_Slab_Class *klass = &slab->classes[i];
+
+	*(void **)tev = klass->free;
+	klass->free = tev;
+	klass->avail++;
+	klass->used--;
+}
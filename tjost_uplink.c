@@ -17,9 +17,10 @@
 
 #include <tjost.h>
 
-static osc_data_t buf_rx [TJOST_BUF_SIZE];
+// per thread, messages are built on the uv loop and on the JACK notification thread
+static __thread osc_data_t buf_rx [TJOST_BUF_SIZE];
 
-// non real time
+// non real time, from any thread
 static void
 tjost_uplink_rx_push(Tjost_Host *host, Tjost_Module *module, osc_data_t *buf, size_t size)
 {
@@ -185,15 +186,7 @@ static osc_method_t methods [] = {
 	{NULL, NULL, NULL}
 };
 
-// non real time
-osc_data_t *
-tjost_uplink_tx_drain_alloc(Tjost_Event *tev, void *arg)
-{
-	static osc_data_t buf_tx [TJOST_BUF_SIZE];
-
-	return buf_tx;
-}
-
+// non real time, buf points into the ring
 int
 tjost_uplink_tx_drain_sched(Tjost_Event *tev, osc_data_t *buf, void *arg)
 {
@@ -204,11 +197,11 @@ tjost_uplink_tx_drain_sched(Tjost_Event *tev, osc_data_t *buf, void *arg)
 
 // real time
 void
-tjost_uplink_tx_push(Tjost_Host *host, Tjost_Event *tev)
+tjost_uplink_tx_push(Tjost_Host *host, Tjost_Module *module, jack_nframes_t time, Tjost_Event *tev)
 {
 	host->pipe_uplink_tx_count++;
-	if(tjost_pipe_produce(&host->pipe_uplink_tx, tev->module, tev->time, tev->size, tev->buf))
-		tjost_host_message_push(tev->module->host, "tjost_uplink_tx_push: tjost_pipe_produce failed");
+	if(tjost_pipe_produce(&host->pipe_uplink_tx, module, time, tev->size, tev->buf))
+		tjost_host_message_push(host, "tjost_uplink_tx_push: tjost_pipe_produce failed");
 }
 
 // real time
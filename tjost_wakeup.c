@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2015 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+
+#include <tjost.h>
+
+void
+tjost_wakeup_init(Tjost_Wakeup *wake, uv_async_t *async, jack_ringbuffer_t *rb)
+{
+	memset(wake, 0, sizeof(Tjost_Wakeup));
+
+	wake->async = async;
+	wake->rb = rb;
+}
+
+// real time, signal consumer at most once per period
+void
+tjost_host_wakeup(Tjost_Host *host, Tjost_Wakeup *wake, Tjost_Module *module)
+{
+	if(wake->queued)
+		return;
+
+	if(host->nwakeups == TJOST_WAKEUP_SLOTS)
+	{
+		uv_async_send(wake->async);
+		return;
+	}
+
+	wake->host = host;
+	wake->module = module;
+	wake->queued = 1;
+	wake->since = module ? jack_last_frame_time(host->client) : 0;
+
+	host->wakeups[host->nwakeups++] = wake;
+}
+
+// real time, consumer is about to go away
+void
+tjost_host_wakeup_cancel(Tjost_Wakeup *wake)
+{
+	Tjost_Host *host = wake->host;
+	unsigned int i;
+
+	if(!wake->queued)
+		return;
+
+	for(i=0; i<host->nwakeups; i++)
+		if(host->wakeups[i] == wake)
+		{
+			host->wakeups[i] = host->wakeups[--host->nwakeups];
+			break;
+		}
+
+	wake->queued = 0;
+}
+
+// non-urgent consumers wait for their fill level or latency,
+// the ring being half full always wakes them up to prevent overflows
+static inline int
+_tjost_wakeup_due(Tjost_Wakeup *wake, jack_nframes_t now)
+{
+	Tjost_Module *module = wake->module;
+
+	if(!module || !module->wakeup_latency)
+		return 1;
+
+	if(now - wake->since >= module->wakeup_latency)
+		return 1;
+
+	if(wake->rb && module->wakeup_fill)
+	{
+		size_t fill = jack_ringbuffer_read_space(wake->rb);
+
+		if( (fill >= module->wakeup_fill) || (fill >= wake->rb->size / 2) )
+			return 1;
+	}
+
+	return 0;
+}
+
+// real time, at end of period
+void
+tjost_host_wakeup_flush(Tjost_Host *host, jack_nframes_t now)
+{
+	unsigned int i, n = 0;
+
+	for(i=0; i<host->nwakeups; i++)
+	{
+		Tjost_Wakeup *wake = host->wakeups[i];
+
+		if(_tjost_wakeup_due(wake, now))
+		{
+			wake->queued = 0;
+			uv_async_send(wake->async);
+		}
+		else
+			host->wakeups[n++] = wake; // keep for next period
+	}
+
+	host->nwakeups = n;
+
+	// log records pushed from any thread
+	if(__atomic_exchange_n(&host->msg_pending, 0, __ATOMIC_ACQ_REL))
+		uv_async_send(&host->msg);
+}
@@ -767,6 +767,21 @@ size_t tlsf_alloc_overhead()
 	return block_header_overhead;
 }
 
+size_t tlsf_free_max(tlsf_t tlsf)
+{
+	control_t* control = tlsf_cast(control_t*, tlsf);
+	int fl, sl;
+
+	if (!control->fl_bitmap)
+	{
+		return 0;
+	}
+
+	fl = tlsf_fls(control->fl_bitmap);
+	sl = tlsf_fls(control->sl_bitmap[fl]);
+	return block_size(control->blocks[fl][sl]);
+}
+
 pool_t tlsf_add_pool(tlsf_t tlsf, void* mem, size_t bytes)
 {
 	block_header_t* block;
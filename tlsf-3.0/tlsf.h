@@ -54,6 +54,10 @@ size_t tlsf_block_size_max();
 size_t tlsf_pool_overhead();
 size_t tlsf_alloc_overhead();
 
+/* Size of a free block in the largest non-empty size class, constant time.
+** Underestimates the largest free block by at most one second level class. */
+size_t tlsf_free_max(tlsf_t tlsf);
+
 /* Debugging. */
 typedef void (*tlsf_walker)(void* ptr, size_t size, int used, void* user);
 void tlsf_walk_pool(pool_t pool, tlsf_walker walker, void* user);